@@ -55,6 +55,19 @@ void graphics_set_buffer(uint8_t* buffer, uint16_t width, uint16_t height);
 
 void graphics_set_offset(int x, int y);
 
+// Line ring (VGA, HDMI): the buffer holds only `lines` rows (power of 2), row y is read from y % lines. 0: whole frame
+void graphics_set_ring(uint8_t lines);
+
+// Beam position: frame number << 10 | buffer rows of that frame already read by the scanout.
+// The frame number goes up when the scanout latches the buffer of graphics_set_buffer.
+// The TV outputs count frames only, their rows stay 0.
+uint32_t graphics_get_beam();
+
+// Called by the scanout before it reads buffer row y in GRAPHICSMODE_DEFAULT, from the video interrupt. NULL: none
+typedef void (*graphics_row_callback_t)(int y);
+
+void graphics_set_row_callback(graphics_row_callback_t callback);
+
 void graphics_set_palette(uint8_t i, uint32_t color);
 
 void graphics_set_textbuffer(uint8_t* buffer);
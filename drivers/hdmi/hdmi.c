@@ -32,6 +32,9 @@ static int graphics_buffer_width = 0;
 static int graphics_buffer_height = 0;
 static int graphics_buffer_shift_x = 0;
 static int graphics_buffer_shift_y = 0;
+static uint graphics_buffer_ring_mask = ~0u;
+static volatile uint32_t beam = 0;
+static graphics_row_callback_t row_callback = NULL;
 
 //текстовый буфер
 uint8_t* text_buffer = NULL;
@@ -165,6 +168,8 @@ static void pio_set_x(PIO pio, const int sm, uint32_t v) {
 static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
     static uint32_t inx_buf_dma;
     static uint line = 0;
+    static uint8_t* frame_buffer = NULL;
+    static uint32_t frame_number = 0;
     irq_inx++;
 
     dma_hw->ints0 = 1u << dma_chan_ctrl;
@@ -172,6 +177,12 @@ static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
 
     line = line >= 524 ? 0 : line + 1;
 
+    // buffer is latched once per frame, so graphics_set_buffer flips at vertical blank
+    if (line == 0) {
+        frame_buffer = graphics_buffer;
+        beam = ++frame_number << 10;
+    }
+
     if ((line & 1) == 0) return;
 
     inx_buf_dma++;
@@ -179,9 +190,9 @@ static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
 
     uint8_t* activ_buf = (uint8_t *) dma_lines[inx_buf_dma & 1];
 
-    if (graphics_buffer && line < 480) {
+    if (frame_buffer && line < 480) {
         //область изображения
-        uint8_t* input_buffer = &graphics_buffer[(line / 2) * graphics_buffer_width];
+        uint8_t* input_buffer = &frame_buffer[(line / 2) * graphics_buffer_width];
         uint8_t* output_buffer = activ_buf + 72; //для выравнивания синхры;
         int y = line / 2;
         switch (graphics_mode) {
@@ -199,7 +210,10 @@ static void __scratch_y("hdmi_driver") dma_handler_HDMI() {
                 output_buffer += graphics_buffer_shift_x;
 
                 //рисуем сам видеобуфер+пространство справа
-                input_buffer = &graphics_buffer[(y - graphics_buffer_shift_y) * graphics_buffer_width];
+                const int row = y - graphics_buffer_shift_y;
+                if (row_callback && graphics_mode == GRAPHICSMODE_DEFAULT) row_callback(row);
+                input_buffer = &frame_buffer[(row & graphics_buffer_ring_mask) * graphics_buffer_width];
+                beam = frame_number << 10 | row + 1;
 
                 const uint8_t* input_buffer_end = input_buffer + graphics_buffer_width;
 
@@ -581,6 +595,18 @@ void graphics_set_bgcolor(uint32_t color888) //определяем зарезе
     graphics_set_palette(255, color888);
 };
 
+void graphics_set_ring(const uint8_t lines) {
+    graphics_buffer_ring_mask = lines ? lines - 1 : ~0u;
+}
+
+uint32_t graphics_get_beam() {
+    return beam;
+}
+
+void graphics_set_row_callback(graphics_row_callback_t callback) {
+    row_callback = callback;
+}
+
 void graphics_set_offset(int x, int y) {
     graphics_buffer_shift_x = x;
     graphics_buffer_shift_y = y;
@@ -49,6 +49,8 @@ static uint graphics_buffer_width = 0;
 static uint graphics_buffer_height = 0;
 static int graphics_buffer_shift_x = 0;
 static int graphics_buffer_shift_y = 0;
+static graphics_row_callback_t row_callback = NULL;
+static volatile uint32_t beam = 0;
 
 enum graphics_mode_t graphics_mode = GRAPHICSMODE_DEFAULT;
 
@@ -200,6 +202,14 @@ void graphics_set_offset(const int x, const int y) {
     graphics_buffer_shift_y = y;
 }
 
+void graphics_set_row_callback(const graphics_row_callback_t callback) {
+    row_callback = callback;
+}
+
+uint32_t graphics_get_beam() {
+    return beam;
+}
+
 void clrScr(const uint8_t color) {
     memset(&graphics_buffer[0], 0, graphics_buffer_height * graphics_buffer_width);
     lcd_set_window(0, 0,SCREEN_WIDTH,SCREEN_HEIGHT);
@@ -247,14 +257,20 @@ void __inline __scratch_y("refresh_lcd") refresh_lcd() {
             stop_pixels();
             break;
         case GRAPHICSMODE_DEFAULT: {
+            static uint32_t frame_number = 0;
+            // buffer is latched once per refresh, so graphics_set_buffer flips between refreshes
             const uint8_t* bitmap = graphics_buffer;
+            beam = ++frame_number << 10;
             lcd_set_window(graphics_buffer_shift_x, graphics_buffer_shift_y, graphics_buffer_width,
                            graphics_buffer_height);
-            uint32_t i = graphics_buffer_width * graphics_buffer_height;
             start_pixels();
-            // st7789_dma_pixels(graphics_buffer, i);
-            while (--i) {
-               st7789_lcd_put_pixel(pio, sm, palette[*bitmap++ & 63]);
+            // st7789_dma_pixels(graphics_buffer, graphics_buffer_width * graphics_buffer_height);
+            for (int y = 0; y < graphics_buffer_height; y++) {
+                if (row_callback) row_callback(y);
+                for (uint x = graphics_buffer_width; x--;) {
+                    st7789_lcd_put_pixel(pio, sm, palette[*bitmap++ & 63]);
+                }
+                beam = frame_number << 10 | y + 1;
             }
             stop_pixels();
         }
@@ -102,6 +102,7 @@ static G_BUFFER graphics_buffer = {
     .height = 240,
     .width = 320
 };
+static volatile uint32_t beam = 0; // frame number << 10, rows are not counted
 
 
 //пины
@@ -151,6 +152,7 @@ static uint32_t* conv_color[2];
 static uint8_t __scratch_y("buff4") paletteRGB[3][256]; //768 байт
 
 static repeating_timer_t video_timer;
+static graphics_row_callback_t row_callback = NULL;
 
 
 void graphics_set_modeTV(tv_out_mode_t mode) {
@@ -459,6 +461,7 @@ static bool __time_critical_func(video_timer_callbackTV)(repeating_timer_t* rt)
             line_active = 0;
             frame_i++;
             input_buffer = graphics_buffer.data;
+            beam = frame_i << 10;
         }
 
         lines_buf_inx = (lines_buf_inx + 1) % N_LINE_BUF;
@@ -1013,6 +1016,7 @@ static bool __time_critical_func(video_timer_callbackTV)(repeating_timer_t* rt)
                         break;
                         case GRAPHICSMODE_DEFAULT: {
                             //для 8-битного буфера
+                            if (row_callback) row_callback(y);
                             uint8_t* input_buffer8 = input_buffer + y * graphics_buffer.width;
 
                             // todo bgcolor
@@ -1213,6 +1217,14 @@ void graphics_set_offset(const int x, const int y) {
     graphics_buffer.shift_y = y;
 };
 
+void graphics_set_row_callback(const graphics_row_callback_t callback) {
+    row_callback = callback;
+}
+
+uint32_t graphics_get_beam() {
+    return beam;
+}
+
 void clrScr(const uint8_t color) {
     if (text_buffer)
         memset(text_buffer, 0, TEXTMODE_COLS * TEXTMODE_ROWS * 2);
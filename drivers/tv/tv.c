@@ -82,6 +82,7 @@ static graphics_buffer_t graphics_buffer = {
     .width = SCREEN_WIDTH,
     .height = SCREEN_HEIGHT,
 };
+static volatile uint32_t beam = 0; // frame number << 10, rows are not counted
 
 //буферы строк
 //количество буферов задавать кратно степени двойки
@@ -119,6 +120,7 @@ static __aligned(512) __scratch_x("palette_conv") uint32_t conv_color[128];
 static enum graphics_mode_t graphics_mode;
 static output_format_e active_output_format;
 static repeating_timer_t video_timer;
+static graphics_row_callback_t row_callback = NULL;
 
 
 //программа установки начального адреса массива-конвертора
@@ -179,6 +181,7 @@ static void __scratch_x("tv_main_loop") main_video_loopTV() {
             line_active = 0;
             frame_i++;
             input_buffer = graphics_buffer.data;
+            beam = frame_i << 10;
         }
 
         lines_buf_inx = (lines_buf_inx + 1) % N_LINE_BUF;
@@ -487,6 +490,7 @@ static void __scratch_x("tv_main_loop") main_video_loopTV() {
                         //для 8-битного буфера
                         uint8_t* input_buffer8 = input_buffer + y * graphics_buffer.width;
                         if (input_buffer != NULL) {
+                            if (row_callback) row_callback(y);
                             // TODO: shift_y, background_color
                             for (uint x = graphics_buffer.shift_x; x--;) {
                                 *output_buffer++ = 200;
@@ -657,6 +661,14 @@ void graphics_set_offset(const int x, const int y) {
     graphics_buffer.shift_y = y;
 };
 
+void graphics_set_row_callback(const graphics_row_callback_t callback) {
+    row_callback = callback;
+}
+
+uint32_t graphics_get_beam() {
+    return beam;
+}
+
 static bool __not_in_flash_func(video_timer_callbackTV(repeating_timer_t *rt)) {
     main_video_loopTV();
     return true;
@@ -48,6 +48,9 @@ static uint graphics_buffer_width = 0;
 static uint graphics_buffer_height = 0;
 static int graphics_buffer_shift_x = 0;
 static int graphics_buffer_shift_y = 0;
+static uint graphics_buffer_ring_mask = ~0u;
+static volatile uint32_t beam = 0;
+static graphics_row_callback_t row_callback = NULL;
 
 static bool is_flash_line = false;
 static bool is_flash_frame = false;
@@ -81,6 +84,7 @@ void __time_critical_func() dma_handler_VGA() {
         screen_line = 0;
         frame_number++;
         input_buffer = graphics_buffer;
+        beam = frame_number << 10;
     }
 
     if (screen_line >= N_lines_visible) {
@@ -310,10 +314,12 @@ void __time_critical_func() dma_handler_VGA() {
         }
         // Это только для sega
         case GRAPHICSMODE_DEFAULT:
-            input_buffer_8bit = input_buffer + y * width;
+            if (row_callback) row_callback(y);
+            input_buffer_8bit = input_buffer + (y & graphics_buffer_ring_mask) * width;
             for (int i = width; i--;) {
                 *output_buffer_16bit++ = current_palette[*input_buffer_8bit++ & 63];
             }
+            beam = frame_number << 10 | y + 1;
             break;
         case VGA_320x200x256x4:
             input_buffer_8bit = input_buffer + y * (width / 4);
@@ -469,6 +475,18 @@ void graphics_set_buffer(uint8_t* buffer, const uint16_t width, const uint16_t h
 }
 
 
+void graphics_set_ring(const uint8_t lines) {
+    graphics_buffer_ring_mask = lines ? lines - 1 : ~0u;
+}
+
+uint32_t graphics_get_beam() {
+    return beam;
+}
+
+void graphics_set_row_callback(const graphics_row_callback_t callback) {
+    row_callback = callback;
+}
+
 void graphics_set_offset(const int x, const int y) {
     graphics_buffer_shift_x = x;
     graphics_buffer_shift_y = y;
@@ -0,0 +1,191 @@
+/* See LICENSE file for license details */
+
+/*
+ * Pattern row blitter benchmark.
+ * Checks the word-at-a-time kernels of gwenesis_vdp_blit.h against the
+ * per-pixel reference they replace, then times both over the same rows.
+ * Only needs printf and time_us_64, so it can also run on the Pico.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <hardware/timer.h>
+
+#include "gwenesis/vdp/gwenesis_vdp_blit.h"
+
+#define PIX0(P) ( ((P) & 0x000000F0 ) >>   4 )
+#define PIX1(P) ( ((P) & 0x0000000F ) >>   0 )
+#define PIX2(P) ( ((P) & 0x0000F000 ) >>  12 )
+#define PIX3(P) ( ((P) & 0x00000F00 ) >>   8 )
+#define PIX4(P) ( ((P) & 0x00F00000 ) >>  20 )
+#define PIX5(P) ( ((P) & 0x000F0000 ) >>  16 )
+#define PIX6(P) ( ((P) & 0xF0000000 ) >>  28 )
+#define PIX7(P) ( ((P) & 0x0F000000 ) >>  24 )
+
+#define ROWS 4096        // pattern rows, power of 2
+#define LINE_CELLS 41    // cells drawn per plane on a H40 line
+#define LINES 20000
+
+enum { PLANE_B, PLANE_A, SPRITE, SPRITE_OVER_PLANES, KERNELS };
+static const char* const kernel_names[KERNELS] = { "plane B", "plane A", "sprite", "sprite over planes" };
+
+static uint32_t patterns[ROWS];    // VRAM pattern rows
+static uint32_t decoded[ROWS][2];  // as in the tile row cache
+static uint8_t attributes[ROWS];
+static uint8_t line_ref[LINE_CELLS * 8 + 8], line_swar[LINE_CELLS * 8 + 8];
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t next_random() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/******************************************************************************
+ *
+ *  Per pixel reference, as drawn before the word-at-a-time kernels
+ *
+ ******************************************************************************/
+/* Pixel x of the row, PIXx(p) or PIX(7-x)(p) when flipped */
+#define REF_PIX(p, x, fliph) ((p) >> ((((fliph) ? 7 - (x) : (x)) ^ 1) * 4) & 0xF)
+
+static void __attribute__((noinline)) ref_kernel(int kernel, uint8_t* scr, uint32_t p, bool fliph, uint8_t attrs, uint8_t back) {
+    switch (kernel) {
+        case PLANE_B:
+            if (p == 0) {
+                memset(scr, back, 8);
+                return;
+            }
+            #pragma GCC unroll 8
+            for (int x = 0; x < 8; x++)
+                scr[x] = REF_PIX(p, x, fliph) ? attrs | REF_PIX(p, x, fliph) : back;
+            break;
+        case PLANE_A:
+            if (p == 0) return;
+            #pragma GCC unroll 8
+            for (int x = 0; x < 8; x++)
+                if (REF_PIX(p, x, fliph) && ((attrs & PIXATTR_HIPRI) || (scr[x] & PIXATTR_HIPRI) == 0))
+                    scr[x] = attrs | REF_PIX(p, x, fliph);
+            break;
+        case SPRITE:
+            if (p == 0) return;
+            #pragma GCC unroll 8
+            for (int x = 0; x < 8; x++)
+                if (REF_PIX(p, x, fliph) && (scr[x] & PIXATTR_SPRITE) == 0)
+                    scr[x] = attrs | REF_PIX(p, x, fliph);
+            break;
+        case SPRITE_OVER_PLANES: {
+            if (p == 0) return;
+            const uint8_t covered = (attrs & PIXATTR_HIPRI) ? PIXATTR_SPRITE : PIXATTR_SPRITE_HIPRI;
+            #pragma GCC unroll 8
+            for (int x = 0; x < 8; x++)
+                if (REF_PIX(p, x, fliph) && (scr[x] & covered) == 0)
+                    scr[x] = attrs | REF_PIX(p, x, fliph);
+            break;
+        }
+    }
+}
+
+static void __attribute__((noinline)) swar_kernel(int kernel, uint8_t* scr, const uint32_t* row, bool fliph, uint8_t attrs, uint8_t back) {
+    switch (kernel) {
+        case PLANE_B:
+            blit_planeB(scr, row, fliph, attrs, back);
+            break;
+        case PLANE_A:
+            blit_planeA(scr, row, fliph, attrs);
+            break;
+        case SPRITE:
+            blit_sprite(scr, row, fliph, attrs);
+            break;
+        case SPRITE_OVER_PLANES:
+            blit_sprite_over_planes(scr, row, fliph, attrs);
+            break;
+    }
+}
+
+/* A mix of empty, fully opaque and partly transparent rows */
+static void make_rows() {
+    for (int i = 0; i < ROWS; i++) {
+        uint32_t p = next_random();
+        switch (next_random() % 4) {
+            case 0:
+                p = 0;
+                break;
+            case 1:
+                p |= 0x11111111;
+                break;
+            default:
+                for (int x = 0; x < 8; x++)
+                    if (next_random() & 1)
+                        p &= ~(0xFu << x * 4);
+                break;
+        }
+        patterns[i] = p;
+        decoded[i][0] = PIX0(p) | PIX1(p) << 8 | PIX2(p) << 16 | PIX3(p) << 24;
+        decoded[i][1] = PIX4(p) | PIX5(p) << 8 | PIX6(p) << 16 | PIX7(p) << 24;
+        attributes[i] = (next_random() & 0xB0) | (next_random() & 0x08); // priority, palette, flip
+    }
+}
+
+static uint8_t kernel_attrs(int kernel, uint8_t attrs) {
+    return (attrs & 0xB0) | (kernel >= SPRITE ? PIXATTR_SPRITE : 0);
+}
+
+static bool check(int kernel) {
+    for (int i = 0; i < 100000; i++) {
+        const int r = next_random() & (ROWS - 1);
+        const bool fliph = attributes[r] & 0x08;
+        const uint8_t attrs = kernel_attrs(kernel, attributes[r]);
+        const uint8_t back = next_random() & 0x3F;
+        const int offset = next_random() & 7;
+
+        for (int x = 0; x < 16; x++)
+            line_ref[x] = line_swar[x] = next_random();
+        ref_kernel(kernel, line_ref + offset, patterns[r], fliph, attrs, back);
+        swar_kernel(kernel, line_swar + offset, decoded[r], fliph, attrs, back);
+
+        if (memcmp(line_ref, line_swar, 16) != 0) {
+            printf("%s: mismatch for pattern %08x attrs %02x\n", kernel_names[kernel], (unsigned) patterns[r], attrs);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ns per pattern row, over full lines starting at a scroll offset as the renderer does */
+static double bench(int kernel, bool swar) {
+    const uint64_t start = time_us_64();
+    int r = 0;
+    for (int line = 0; line < LINES; line++) {
+        uint8_t* scr = (swar ? line_swar : line_ref) + (line & 7);
+        for (int cell = 0; cell < LINE_CELLS; cell++, scr += 8, r = (r + 1) & (ROWS - 1)) {
+            const uint8_t attrs = kernel_attrs(kernel, attributes[r]);
+            if (swar)
+                swar_kernel(kernel, scr, decoded[r], attributes[r] & 0x08, attrs, 0);
+            else
+                ref_kernel(kernel, scr, patterns[r], attributes[r] & 0x08, attrs, 0);
+        }
+    }
+    return (time_us_64() - start) * 1000.0 / ((double) LINES * LINE_CELLS);
+}
+
+int main() {
+    make_rows();
+
+    bool ok = true;
+    for (int kernel = 0; kernel < KERNELS; kernel++)
+        ok &= check(kernel);
+    if (!ok)
+        return 1;
+
+    printf("%-20s %10s %10s\n", "ns per row", "per pixel", "word");
+    for (int kernel = 0; kernel < KERNELS; kernel++) {
+        const double ref = bench(kernel, false);
+        const double swar = bench(kernel, true);
+        printf("%-20s %10.2f %10.2f\n", kernel_names[kernel], ref, swar);
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+/* See LICENSE file for license details */
+
+/*
+ * Host stand-in for drivers/graphics/graphics.h. The emulator core only needs
+ * the palette hooks and the RGB888 packing macro; the palette is kept in a
+ * plain array so the benchmark can inspect it.
+ */
+#ifndef _HOST_GRAPHICS_H_
+#define _HOST_GRAPHICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#define TEXTMODE_COLS 80
+#define TEXTMODE_ROWS 30
+
+#define RGB888(r, g, b) ((r<<16) | (g << 8 ) | b )
+
+extern uint32_t host_palette[256];
+
+void graphics_set_buffer(uint8_t* buffer, uint16_t width, uint16_t height);
+
+void graphics_set_offset(int x, int y);
+
+void graphics_set_palette(uint8_t i, uint32_t color);
+
+typedef void (*graphics_row_callback_t)(int y);
+
+void graphics_set_row_callback(graphics_row_callback_t callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
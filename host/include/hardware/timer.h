@@ -0,0 +1,23 @@
+/* See LICENSE file for license details */
+
+/*
+ * Host stand-in for the Pico SDK hardware/timer.h: the free running
+ * microsecond timer is backed by CLOCK_MONOTONIC.
+ */
+#ifndef _HOST_HARDWARE_TIMER_H_
+#define _HOST_HARDWARE_TIMER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t time_us_64(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static inline uint32_t time_us_32(void) {
+    return (uint32_t) time_us_64();
+}
+
+#endif
@@ -0,0 +1,52 @@
+/* See LICENSE file for license details */
+
+/*
+ * Minimal stand-in for the Pico SDK <pico.h> so the gwenesis core can be
+ * compiled on a Linux host. Only the section placement attributes and helper
+ * macros actually used by src/gwenesis are provided; all of them collapse to
+ * plain C on the host.
+ */
+#ifndef _HOST_PICO_H_
+#define _HOST_PICO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sched.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) __attribute__((noinline)) func_name
+#define __in_flash(group)
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __uninitialized_ram(var) var
+
+#ifndef __aligned
+#define __aligned(x) __attribute__((aligned(x)))
+#endif
+#ifndef __always_inline
+#define __always_inline inline __attribute__((__always_inline__))
+#endif
+#ifndef __force_inline
+#define __force_inline __always_inline
+#endif
+#ifndef __noinline
+#define __noinline __attribute__((noinline))
+#endif
+
+#define __unreachable() __builtin_unreachable()
+
+#define __fast_mul(a, b) ((a) * (b))
+#define __mul_instruction(a, b) ((a) * (b))
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Busy-wait loops yield, so a thread standing in for the other core can run
+ * even on a single CPU host */
+#define tight_loop_contents() sched_yield()
+
+#endif
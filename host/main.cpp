@@ -0,0 +1,776 @@
+/* See LICENSE file for license details */
+
+/*
+ * Headless frame-throughput benchmark for the gwenesis core.
+ *
+ * Runs the same per-scanline loop as emulate() in src/main.cpp against a ROM
+ * image for a fixed number of frames, with no display, input or audio output,
+ * and reports frames per second and per-frame wall time. Checksums of the
+ * final framebuffer and palette are printed so that renderer changes can be
+ * checked for identical output.
+ *
+ * usage: genesis-bench [-n frames] [-z z80_mode] [-f max_skip] [-p] [-q] [-c] [-y] [-i] [-u] [-r]
+ *                      [-o profile] [-s samples] [rom.bin]
+ *
+ * Without a ROM file a small built-in test program is used which sets up the
+ * VDP, fills VRAM with noise and scrolls the planes once per vblank. It also
+ * shows the window plane, moves 20 sprites sent by DMA, turns on
+ * shadow/highlight and starts a Z80 program that drives the plane B vertical
+ * scroll, so the checksums cover those renderer paths too.
+ * With -c only the 68K runs, on a short loop of the built-in ROM, and the
+ * instruction rate is reported instead. -y does the same for the Z80, with a
+ * sound driver like loop loaded into Z80 RAM and run once per line.
+ * Built with OPCODE_PROFILE, -o writes the executed 68K opcodes, opcodes with
+ * register fields masked and consecutive opcode pairs, ranked by count.
+ * Built with PROFILE, -s samples the 68K PC from a second thread as the
+ * firmware does from core 1 and writes the same report.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "gwenesis/cpus/M68K/m68k.h"
+#include "gwenesis/cpus/M68K/m68kconf.h"
+#include "gwenesis/sound/z80inst.h"
+#include "gwenesis/bus/gwenesis_bus.h"
+#include "gwenesis/io/gwenesis_io.h"
+#include "gwenesis/vdp/gwenesis_vdp.h"
+#include "gwenesis/savestate/gwenesis_savestate.h"
+#include <gwenesis/sound/gwenesis_sn76489.h>
+#include <gwenesis/sound/ym2612.h>
+#include <gwenesis/perf/gwenesis_perf.h>
+#include <gwenesis/perf/gwenesis_profile.h>
+}
+
+#include <pico.h>
+
+#include "graphics.h"
+
+/* Largest cartridge address space the 68K can see as ROM */
+#define MAX_ROM_SIZE 0x800000
+
+uint8_t snd_accurate = 0;
+/* shared variables with gwenesis_sn76589 */
+int16_t gwenesis_sn76489_buffer[GWENESIS_AUDIO_BUFFER_LENGTH_NTSC * 2];
+int sn76489_index;
+int sn76489_clock;
+
+int audio_enabled = 1;
+int snd_output_volume = 9;
+static uint8_t SCREEN[240][320];
+
+// SETTINGS
+bool interlace = false;
+uint8_t frameskip = 0; // maximum consecutive frames not drawn, 0 disables
+int z80_enable_mode = 2;
+bool sn76489_enabled = true;
+
+int frame = 0;
+int system_clock;
+unsigned int lines_per_frame = LINES_PER_FRAME_NTSC;
+int scan_line;
+unsigned int frame_counter = 0;
+unsigned int drawFrame = 1;
+
+extern unsigned char gwenesis_vdp_regs[0x20];
+extern unsigned short gwenesis_vdp_status;
+extern unsigned int screen_width, screen_height;
+extern int hint_pending;
+
+uint32_t host_palette[256];
+
+extern "C" void graphics_set_buffer(uint8_t*, uint16_t, uint16_t) {
+}
+
+extern "C" void graphics_set_offset(int, int) {
+}
+
+extern "C" void graphics_set_palette(const uint8_t i, const uint32_t color) {
+    host_palette[i] = color;
+}
+
+extern "C" void graphics_set_row_callback(graphics_row_callback_t) {
+}
+
+/* No input on the host: all pads released */
+extern "C" void gwenesis_io_get_buttons() {
+}
+
+static inline uint64_t time_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* FNV hash of the palette every visible line of the last frame was shown with */
+static bool hash_lines = false;
+
+static inline bool line_palettes() {
+#if GWENESIS_VDP_LINE_PALETTES
+    return gwenesis_vdp_line_palettes;
+#else
+    return false;
+#endif
+}
+static uint32_t lines_hash = 2166136261u;
+
+static void hash_line_palette() {
+    for (unsigned int i = 0; i < 64; i++)
+        lines_hash = (lines_hash ^ host_palette[i]) * 16777619u;
+}
+
+/* One frame of emulate() from src/main.cpp, without the frame limiter */
+static void emulate_frame() {
+    int hint_counter = gwenesis_vdp_regs[10];
+
+    const bool is_pal = REG1_PAL;
+    screen_width = REG12_MODE_H40 ? 320 : 256;
+    screen_height = is_pal ? 240 : 224;
+    lines_per_frame = is_pal ? LINES_PER_FRAME_PAL : LINES_PER_FRAME_NTSC;
+    const int visible_lines = screen_height, frame_lines = lines_per_frame; // scan_line is signed
+
+    graphics_set_buffer((uint8_t *) SCREEN, screen_width, screen_height);
+    graphics_set_offset(screen_width != 320 ? 32 : 0, screen_height != 240 ? 8 : 0);
+    gwenesis_vdp_render_config();
+
+    // odd lines of an interlace frame are only drawn on even frames
+    drawFrame = gwenesis_vdp_frame_begin(gwenesis_vdp_frame_due(is_pal, frameskip), !interlace || frame % 2 == 0);
+
+    zclk = 0;
+    /* Reset the difference clocks and audio index */
+    system_clock = 0;
+    sn76489_clock = 0;
+    sn76489_index = 0;
+    scan_line = 0;
+    gwenesis_vdp_palette_frame_begin();
+    if (z80_enable_mode == 1) {
+        PERF_SWITCH(PERF_Z80);
+        z80_run(lines_per_frame * VDP_CYCLES_PER_LINE);
+        PERF_SWITCH(PERF_OTHER);
+    }
+
+    while (scan_line < frame_lines) {
+        /* CPUs */
+        PERF_SWITCH(PERF_M68K);
+        m68k_run(system_clock + VDP_CYCLES_PER_LINE);
+        if (z80_enable_mode == 2) {
+            PERF_SWITCH(PERF_Z80);
+            z80_run(system_clock + VDP_CYCLES_PER_LINE);
+        }
+        // CRAM entries the CPUs changed during the line
+        gwenesis_vdp_palette_commit();
+        if (hash_lines && !line_palettes() && scan_line < visible_lines)
+            hash_line_palette();
+        /* Video */
+        // Interlace mode
+        if (drawFrame && (!interlace || (frame % 2 == 0 && scan_line % 2) || scan_line % 2 == 0)) {
+            PERF_SWITCH(PERF_VDP);
+            gwenesis_vdp_render_line(scan_line); /* render scan_line */
+        }
+        PERF_SWITCH(PERF_OTHER);
+
+        // On these lines, the line counter interrupt is reloaded
+        if (scan_line == 0 || scan_line > visible_lines) {
+            hint_counter = REG10_LINE_COUNTER;
+        }
+
+        // interrupt line counter
+        if (--hint_counter < 0) {
+            if (REG0_LINE_INTERRUPT != 0 && scan_line <= visible_lines) {
+                hint_pending = 1;
+                if ((gwenesis_vdp_status & STATUS_VIRQPENDING) == 0)
+                    m68k_update_irq(4);
+            }
+            hint_counter = REG10_LINE_COUNTER;
+        }
+
+        scan_line++;
+
+        // vblank begin at the end of last rendered line
+        if (scan_line == visible_lines) {
+            gwenesis_vdp_palette_frame_end();
+            if (REG1_VBLANK_INTERRUPT != 0) {
+                gwenesis_vdp_status |= STATUS_VIRQPENDING;
+                m68k_set_irq(6);
+            }
+            z80_irq_line(1);
+        }
+
+        if (!is_pal && scan_line == visible_lines + 1) {
+            z80_irq_line(0);
+        }
+
+        system_clock += VDP_CYCLES_PER_LINE;
+    }
+
+    frame++;
+    if (audio_enabled) {
+        PERF_SWITCH(PERF_SOUND);
+        gwenesis_SN76489_run(lines_per_frame * VDP_CYCLES_PER_LINE);
+        PERF_SWITCH(PERF_OTHER);
+    }
+
+    // reset m68k cycles to the begin of next frame cycle
+    m68k.cycles -= system_clock;
+
+    PERF_END_FRAME();
+}
+
+/******************************************************************************
+ *
+ *   Built-in test program, stored big-endian as on a cartridge
+ *
+ ******************************************************************************/
+static const uint16_t test_program[] = {
+    0x41F9, 0x00C0, 0x0004, /* 0x200 lea     $C00004,a0            */
+    0x43F9, 0x00C0, 0x0000, /* 0x206 lea     $C00000,a1            */
+    0x45FA, 0x00DC,         /* 0x20C lea     regs(pc),a2           */
+    0x700D,                 /* 0x210 moveq   #13,d0                */
+    0x309A,                 /* 0x212 move.w  (a2)+,(a0)            */
+    0x51C8, 0xFFFC,         /* 0x214 dbra    d0,0x212              */
+    0x20BC, 0xC000, 0x0000, /* 0x218 move.l  #CRAM write 0,(a0)    */
+    0x7200,                 /* 0x21E moveq   #0,d1                 */
+    0x703F,                 /* 0x220 moveq   #63,d0                */
+    0x3281,                 /* 0x222 move.w  d1,(a1)               */
+    0x0641, 0x0246,         /* 0x224 addi.w  #$0246,d1             */
+    0x51C8, 0xFFF8,         /* 0x228 dbra    d0,0x222              */
+    0x20BC, 0x4000, 0x0000, /* 0x22C move.l  #VRAM write 0,(a0)    */
+    0x303C, 0x7FFF,         /* 0x232 move.w  #$7FFF,d0             */
+    0x3281,                 /* 0x236 move.w  d1,(a1)               */
+    0x0641, 0x1357,         /* 0x238 addi.w  #$1357,d1             */
+    0xE359,                 /* 0x23C rol.w   #1,d1                 */
+    0x51C8, 0xFFF6,         /* 0x23E dbra    d0,0x236              */
+    0x47FA, 0x02BC,         /* 0x242 lea     sat(pc),a3            */
+    0x49F9, 0x00FF, 0x1000, /* 0x246 lea     $FF1000,a4            */
+    0x7027,                 /* 0x24C moveq   #39,d0                */
+    0x28DB,                 /* 0x24E move.l  (a3)+,(a4)+           */
+    0x51C8, 0xFFFC,         /* 0x250 dbra    d0,0x24E              */
+    0x33FC, 0x0100, 0x00A1, 0x1100, /* 0x254 move.w  #$0100,$A11100 (Z80 bus) */
+    0x47FA, 0x0222,         /* 0x25C lea     z80(pc),a3            */
+    0x49F9, 0x00A0, 0x0000, /* 0x260 lea     $A00000,a4            */
+    0x7018,                 /* 0x266 moveq   #24,d0                */
+    0x18DB,                 /* 0x268 move.b  (a3)+,(a4)+           */
+    0x51C8, 0xFFFC,         /* 0x26A dbra    d0,0x268              */
+    0x33FC, 0x0100, 0x00A1, 0x1200, /* 0x26E move.w  #$0100,$A11200 (Z80 reset) */
+    0x33FC, 0x0000, 0x00A1, 0x1100, /* 0x276 move.w  #$0000,$A11100 */
+    0x46FC, 0x2000,         /* 0x27E move.w  #$2000,sr             */
+    0x4239, 0x00FF, 0x0002, /* 0x282 clr.b   $FF0002               */
+    0x4A39, 0x00FF, 0x0002, /* 0x288 tst.b   $FF0002               */
+    0x67F8,                 /* 0x28E beq.s   0x288                 */
+    0x20BC, 0x5C00, 0x0003, /* 0x290 move.l  #VRAM write DC00,(a0) */
+    0x3282,                 /* 0x296 move.w  d2,(a1)               */
+    0x3282,                 /* 0x298 move.w  d2,(a1)               */
+    0x20BC, 0x4000, 0x0010, /* 0x29A move.l  #VSRAM write 0,(a0)   */
+    0x7600,                 /* 0x2A0 moveq   #0,d3                 */
+    0x1639, 0x00A0, 0x1F00, /* 0x2A2 move.b  $A01F00,d3 (Z80 count) */
+    0x3282,                 /* 0x2A8 move.w  d2,(a1)               */
+    0x3283,                 /* 0x2AA move.w  d3,(a1)               */
+    0x47F9, 0x00FF, 0x1006, /* 0x2AC lea     $FF1006,a3            */
+    0x7013,                 /* 0x2B2 moveq   #19,d0                */
+    0xD153,                 /* 0x2B4 add.w   d0,(a3)               */
+    0x504B,                 /* 0x2B6 addq.w  #8,a3                 */
+    0x51C8, 0xFFFA,         /* 0x2B8 dbra    d0,0x2B4              */
+    0x30BC, 0x9350,         /* 0x2BC move.w  #$9350,(a0) (DMA length) */
+    0x30BC, 0x9400,         /* 0x2C0 move.w  #$9400,(a0)           */
+    0x30BC, 0x9500,         /* 0x2C4 move.w  #$9500,(a0) (source $FF1000) */
+    0x30BC, 0x9688,         /* 0x2C8 move.w  #$9688,(a0)           */
+    0x30BC, 0x977F,         /* 0x2CC move.w  #$977F,(a0)           */
+    0x20BC, 0x5800, 0x0083, /* 0x2D0 move.l  #VRAM DMA D800,(a0)   */
+    0x5242,                 /* 0x2D6 addq.w  #1,d2                 */
+    0x52B9, 0x00FF, 0x0000, /* 0x2D8 addq.l  #1,$FF0000            */
+    0x60A2,                 /* 0x2DE bra.s   0x282                 */
+    0x13FC, 0x0001, 0x00FF, 0x0002, /* 0x2E0 move.b #1,$FF0002 (vint) */
+    0x4E73,                 /* 0x2E8 rte                           */
+    /* 0x2EA regs: mode, display+vint+dma, planes, window, SAT, H40+shadow/highlight,
+     * hscroll, autoinc, 64x32, window left 8 columns and top 5 rows */
+    0x8004, 0x8174, 0x8230, 0x8334, 0x8407, 0x856C, 0x8700,
+    0x8B00, 0x8C89, 0x8D37, 0x8F02, 0x9001, 0x9104, 0x9205,
+};
+
+/* Z80 program copied to Z80 RAM and started by the test program: counts at
+ * $1F00 (the plane B vertical scroll of the next frame) and keys FM channels */
+#define TEST_Z80_ADDRESS 0x480
+static const uint8_t test_z80_program[] = {
+    0xF3,                   /* 0000 di                 */
+    0x31, 0xF0, 0x1F,       /* 0001 ld   sp,$1FF0      */
+    0x3A, 0x00, 0x1F,       /* 0004 ld   a,($1F00)     */
+    0x3C,                   /* 0007 inc  a             */
+    0x32, 0x00, 0x1F,       /* 0008 ld   ($1F00),a     */
+    0x47,                   /* 000B ld   b,a           */
+    0x3E, 0x28,             /* 000C ld   a,$28         */
+    0x32, 0x00, 0x40,       /* 000E ld   ($4000),a     */
+    0x78,                   /* 0011 ld   a,b           */
+    0xE6, 0xF0,             /* 0012 and  $F0           */
+    0x32, 0x01, 0x40,       /* 0014 ld   ($4001),a     */
+    0x18, 0xEB,             /* 0017 jr   $0004         */
+};
+
+/* Sprite table of the test program, copied to work RAM and sent by DMA on
+ * every frame with each sprite moved by its index */
+#define TEST_SAT_ADDRESS 0x500
+#define TEST_SPRITES 20
+
+/* 68K only benchmark loop (-c), 6 instructions per iteration counted in d0 */
+#define CPU_LOOP_ADDRESS 0x400
+#define CPU_LOOP_INSTRUCTIONS 6
+static const uint16_t cpu_loop_program[] = {
+    0x41F9, 0x00FF, 0x0000, /* 0x400 lea     $FF0000,a0            */
+    0x7000,                 /* 0x406 moveq   #0,d0                 */
+    0x3210,                 /* 0x408 move.w  (a0),d1               */
+    0xD2BC, 0x0001, 0x2345, /* 0x40A add.l   #$12345,d1            */
+    0x3081,                 /* 0x410 move.w  d1,(a0)               */
+    0xE389,                 /* 0x412 lsl.l   #1,d1                 */
+    0x5280,                 /* 0x414 addq.l  #1,d0                 */
+    0x60F0,                 /* 0x416 bra.s   0x408                 */
+};
+
+/* Z80 only benchmark loop (-y), 14 instructions per iteration counted at $1F00 */
+#define Z80_LOOP_COUNTER 0x1F00
+#define Z80_LOOP_INSTRUCTIONS 14
+static const uint8_t z80_loop_program[] = {
+    0xF3,                   /* 0000 di                 */
+    0x31, 0xF0, 0x1F,       /* 0001 ld   sp,$1FF0      */
+    0x21, 0x00, 0x10,       /* 0004 ld   hl,$1000      */
+    0x11, 0x00, 0x18,       /* 0007 ld   de,$1800      */
+    0xDD, 0x21, 0x00, 0x1F, /* 000A ld   ix,$1F00      */
+    0x7E,                   /* 000E ld   a,(hl)        */
+    0x2C,                   /* 000F inc  l             */
+    0x86,                   /* 0010 add  a,(hl)        */
+    0x12,                   /* 0011 ld   (de),a        */
+    0x1C,                   /* 0012 inc  e             */
+    0xC5,                   /* 0013 push bc            */
+    0xC1,                   /* 0014 pop  bc            */
+    0xCB, 0x3F,             /* 0015 srl  a             */
+    0xE6, 0x0F,             /* 0017 and  $0F           */
+    0xFE, 0x08,             /* 0019 cp   8             */
+    0xCD, 0x30, 0x00,       /* 001B call $0030         */
+    0xDD, 0x34, 0x00,       /* 001E inc  (ix+0)        */
+    0x20, 0xEB,             /* 0021 jr   nz,$000E      */
+    0xDD, 0x34, 0x01,       /* 0023 inc  (ix+1)        */
+    0x20, 0xE6,             /* 0026 jr   nz,$000E      */
+    0xDD, 0x34, 0x02,       /* 0028 inc  (ix+2)        */
+    0x18, 0xE1,             /* 002B jr   $000E         */
+    0x00, 0x00, 0x00,       /* 002D                    */
+    0xC9,                   /* 0030 ret                */
+};
+
+static void build_test_rom(std::vector<uint8_t> &rom) {
+    auto put32 = [&rom](const uint32_t addr, const uint32_t value) {
+        rom[addr + 0] = value >> 24;
+        rom[addr + 1] = value >> 16;
+        rom[addr + 2] = value >> 8;
+        rom[addr + 3] = value;
+    };
+
+    put32(0x000, 0x00FFFE00); /* initial SSP */
+    put32(0x004, 0x00000200); /* initial PC */
+    for (uint32_t vector = 2; vector < 64; vector++)
+        put32(vector * 4, 0x000002E8);
+    put32(30 * 4, 0x000002E0); /* level 6 autovector: vblank */
+
+    memcpy(&rom[0x100], "SEGA MEGA DRIVE ", 16);
+    memset(&rom[0x120], ' ', 0x1F0 - 0x120);
+    memcpy(&rom[0x150], "HOST BENCHMARK", 14);
+    memcpy(&rom[0x1F0], "U  ", 3);
+
+    for (size_t i = 0; i < sizeof(test_program) / sizeof(test_program[0]); i++) {
+        rom[0x200 + i * 2 + 0] = test_program[i] >> 8;
+        rom[0x200 + i * 2 + 1] = test_program[i] & 0xFF;
+    }
+    for (size_t i = 0; i < sizeof(cpu_loop_program) / sizeof(cpu_loop_program[0]); i++) {
+        rom[CPU_LOOP_ADDRESS + i * 2 + 0] = cpu_loop_program[i] >> 8;
+        rom[CPU_LOOP_ADDRESS + i * 2 + 1] = cpu_loop_program[i] & 0xFF;
+    }
+    memcpy(&rom[TEST_Z80_ADDRESS], test_z80_program, sizeof(test_z80_program));
+
+    // all sizes, both priorities, the four palettes (3 has the shadow/highlight
+    // operators), flips, overlapping on some lines, linked in order
+    for (uint32_t i = 0; i < TEST_SPRITES; i++) {
+        const uint32_t sprite = TEST_SAT_ADDRESS + i * 8;
+        put32(sprite + 0, (128 + 8 + (i * 37) % 200) << 16 | (i & 15) << 8 | (i + 1) % TEST_SPRITES);
+        put32(sprite + 4, ((i & 1) << 15 | (i & 3) << 13 | (i & 4) << 10 | (i & 8) << 8 | (0x40 + i * 16)) << 16 |
+                          (100 + (i * 53) % 340));
+    }
+}
+
+/* Run the 68K alone on the built-in loop for as many cycles as the frames would take */
+static void cpu_benchmark(const int frames) {
+    const unsigned int frame_cycles = LINES_PER_FRAME_NTSC * VDP_CYCLES_PER_LINE;
+
+    m68k_set_reg(M68K_REG_PC, CPU_LOOP_ADDRESS);
+    const uint64_t start = time_ns();
+    for (int i = 0; i < frames; i++) {
+        m68k_run(frame_cycles);
+        m68k.cycles -= frame_cycles;
+    }
+    const uint64_t total = time_ns() - start;
+    const double instructions = (double) m68k_get_reg(M68K_REG_D0) * CPU_LOOP_INSTRUCTIONS;
+
+    printf("frames    : %d (68K only)\n", frames);
+    printf("total     : %.3f s\n", total / 1e9);
+    printf("68K MIPS  : %.2f\n", instructions / (total / 1e3));
+    printf("ns/instr  : %.2f\n", total / instructions);
+    printf("dispatch  : %.1f KB of opcode tables\n", m68k_dispatch_bytes() / 1024.0);
+}
+
+/* Run the Z80 alone on its loop, once per line as with -z 2, for as many cycles as the frames would take */
+static void z80_benchmark(const int frames) {
+    for (size_t i = 0; i < sizeof(z80_loop_program); i++)
+        m68k_write_memory_8(0xA00000 + i, z80_loop_program[i]);
+    m68k_write_memory_8(0xA11200, 1); /* release the Z80 reset */
+
+    const uint64_t start = time_ns();
+    for (int i = 0; i < frames; i++) {
+        zclk = 0;
+        for (unsigned int line = 1; line <= LINES_PER_FRAME_NTSC; line++)
+            z80_run(line * VDP_CYCLES_PER_LINE);
+    }
+    const uint64_t total = time_ns() - start;
+    const uint32_t count = m68k_read_memory_8(0xA00000 + Z80_LOOP_COUNTER) |
+                           m68k_read_memory_8(0xA00000 + Z80_LOOP_COUNTER + 1) << 8 |
+                           m68k_read_memory_8(0xA00000 + Z80_LOOP_COUNTER + 2) << 16;
+    const double instructions = (double) count * Z80_LOOP_INSTRUCTIONS;
+    const double z80_seconds = (double) frames * LINES_PER_FRAME_NTSC * VDP_CYCLES_PER_LINE / Z80_FREQ_DIVISOR / 3579545.0;
+
+    printf("frames    : %d (Z80 only)\n", frames);
+    printf("total     : %.3f s\n", total / 1e9);
+    printf("Z80 MIPS  : %.2f\n", instructions / (total / 1e3));
+    printf("ns/instr  : %.2f\n", total / instructions);
+    printf("real time : x%.1f\n", z80_seconds / (total / 1e9));
+}
+
+static bool load_rom_file(const char *pathname, std::vector<uint8_t> &rom) {
+    FILE *file = fopen(pathname, "rb");
+    if (!file) {
+        perror(pathname);
+        return false;
+    }
+    const size_t bytes_read = fread(rom.data(), 1, rom.size(), file);
+    fclose(file);
+    if (!bytes_read) {
+        fprintf(stderr, "%s: empty ROM\n", pathname);
+        return false;
+    }
+    return true;
+}
+
+/* FNV-1a over the visible part of the framebuffer */
+static uint32_t screen_checksum() {
+    uint32_t hash = 2166136261u;
+    for (unsigned int y = 0; y < screen_height; y++)
+        for (unsigned int x = 0; x < screen_width; x++)
+            hash = (hash ^ SCREEN[y][x]) * 16777619u;
+    return hash;
+}
+
+static uint32_t palette_checksum() {
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < 64; i++)
+        hash = (hash ^ host_palette[i]) * 16777619u;
+    return hash;
+}
+
+#if M68K_OPCODE_PROFILE
+/* Ranked 68K opcode profile, top entries of each table */
+#define PROFILE_TOP 200
+
+static void write_rank(FILE *file, std::vector<std::pair<uint64_t, uint32_t>> &counts, const uint64_t total,
+                       const bool pairs) {
+    std::sort(counts.begin(), counts.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    uint64_t cumulative = 0;
+    for (size_t rank = 0; rank < counts.size() && rank < PROFILE_TOP; rank++) {
+        cumulative += counts[rank].first;
+        if (pairs)
+            fprintf(file, "%4zu  %04x %04x  %12llu  %6.2f%%  %6.2f%%\n", rank + 1, counts[rank].second >> 16,
+                    counts[rank].second & 0xFFFF, (unsigned long long) counts[rank].first,
+                    100.0 * counts[rank].first / total, 100.0 * cumulative / total);
+        else
+            fprintf(file, "%4zu  %04x  %12llu  %6.2f%%  %6.2f%%\n", rank + 1, counts[rank].second,
+                    (unsigned long long) counts[rank].first, 100.0 * counts[rank].first / total,
+                    100.0 * cumulative / total);
+    }
+}
+#endif
+
+static bool write_profile(const char *pathname, const int frames) {
+#if M68K_OPCODE_PROFILE
+    FILE *file = fopen(pathname, "w");
+    if (!file) {
+        perror(pathname);
+        return false;
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> opcodes, modes, pairs;
+    std::vector<uint64_t> mode_hits(0x10000, 0);
+    uint64_t total = 0;
+    for (uint32_t ir = 0; ir < 0x10000; ir++) {
+        if (!m68k_opcode_hits[ir])
+            continue;
+        total += m68k_opcode_hits[ir];
+        opcodes.emplace_back(m68k_opcode_hits[ir], ir);
+        // register fields masked: instruction and EA modes
+        mode_hits[ir & 0xF1F8] += m68k_opcode_hits[ir];
+    }
+    for (uint32_t ir = 0; ir < 0x10000; ir++)
+        if (mode_hits[ir])
+            modes.emplace_back(mode_hits[ir], ir);
+    uint64_t pair_total = 0;
+    for (int i = 0; i < M68K_OPCODE_PAIRS; i++)
+        if (m68k_opcode_pairs[i].hits) {
+            pair_total += m68k_opcode_pairs[i].hits;
+            pairs.emplace_back(m68k_opcode_pairs[i].hits, m68k_opcode_pairs[i].pair);
+        }
+
+    fprintf(file, "# 68K opcode profile: %d frames, %llu instructions, %zu opcodes, %u pairs not counted\n",
+            frames, (unsigned long long) total, opcodes.size(), m68k_opcode_pairs_lost);
+    fprintf(file, "\n# rank  opcode  count  %%  cumulative %%\n");
+    write_rank(file, opcodes, total, false);
+    fprintf(file, "\n# rank  opcode & f1f8 (register fields masked)  count  %%  cumulative %%\n");
+    write_rank(file, modes, total, false);
+    fprintf(file, "\n# rank  first second  count  %%  cumulative %%\n");
+    write_rank(file, pairs, pair_total, true);
+    fclose(file);
+    return true;
+#else
+    (void) frames;
+    fprintf(stderr, "%s: built without OPCODE_PROFILE\n", pathname);
+    return false;
+#endif
+}
+
+#if GWENESIS_PROFILE
+static bool write_sample_line(void *context, const char *line) {
+    return fputs(line, (FILE *) context) >= 0;
+}
+#endif
+
+static bool write_samples(const char *pathname, const char *title) {
+#if GWENESIS_PROFILE
+    FILE *file = fopen(pathname, "w");
+    if (!file) {
+        perror(pathname);
+        return false;
+    }
+    const bool written = gwenesis_profile_write(title, write_sample_line, file);
+    return !fclose(file) && written;
+#else
+    (void) title;
+    fprintf(stderr, "%s: built without PROFILE\n", pathname);
+    return false;
+#endif
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n frames] [-z z80_mode] [-f max_skip] [-p] [-q] [-c] [-y] [-i] [-u] [-r] [-l] [-o profile] "
+                    "[-s samples] [rom.bin]\n"
+                    "  -n frames    number of frames to run (default 600)\n"
+                    "  -z mode      0: Z80 off, 1: per frame, 2: per line (default 2)\n"
+                    "  -f max_skip  adaptive frameskip, only when slower than real time (default 0)\n"
+                    "  -p           render lines on a second thread through the VDP line pipeline\n"
+                    "  -q           disable SN76489 audio generation\n"
+                    "  -c           68K only: run a built-in instruction loop and report MIPS\n"
+                    "  -y           Z80 only: run a built-in instruction loop and report MIPS\n"
+                    "  -i           disable 68K and Z80 idle loop skipping\n"
+                    "  -u           disable 68K fused DBF loops\n"
+                    "  -r           draw every frame, even when nothing on screen changed\n"
+                    "  -l           record CRAM changes per line and scan the last frame out with them (VDP_LINE_PALETTES)\n"
+                    "  -o profile   write the 68K opcode profile (OPCODE_PROFILE build, fused loops off)\n"
+                    "  -s samples   write the 68K PC samples (PROFILE build)\n", name);
+}
+
+int main(int argc, char **argv) {
+    int frames = 600;
+    const char *rom_path = nullptr;
+    bool cpu_only = false;
+    bool z80_only = false;
+    const char *profile_path = nullptr;
+    const char *samples_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-z") && i + 1 < argc) {
+            z80_enable_mode = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            frameskip = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p")) {
+            gwenesis_vdp_set_pipeline(true);
+        } else if (!strcmp(argv[i], "-q")) {
+            audio_enabled = 0;
+        } else if (!strcmp(argv[i], "-c")) {
+            cpu_only = true;
+        } else if (!strcmp(argv[i], "-y")) {
+            z80_only = true;
+        } else if (!strcmp(argv[i], "-i")) {
+            m68k_idle_skip = 0;
+            z80_idle_skip = 0;
+        } else if (!strcmp(argv[i], "-u")) {
+#if M68K_FUSED_LOOPS
+            m68k_fused_loops = 0;
+#endif
+        } else if (!strcmp(argv[i], "-r")) {
+            gwenesis_vdp_skip_unchanged = 0;
+        } else if (!strcmp(argv[i], "-l")) {
+#if GWENESIS_VDP_LINE_PALETTES
+            gwenesis_vdp_line_palettes = 1;
+#endif
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            samples_path = argv[++i];
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            profile_path = argv[++i];
+#if M68K_FUSED_LOOPS
+            // count every pass of the loops as executed
+            m68k_fused_loops = 0;
+#endif
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            rom_path = argv[i];
+        }
+    }
+    if (frames <= 0 || ((cpu_only || z80_only) && rom_path)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> rom(MAX_ROM_SIZE, 0);
+    if (rom_path) {
+        if (!load_rom_file(rom_path, rom))
+            return 1;
+    } else {
+        build_test_rom(rom);
+    }
+
+    // SWAP LO<>HI, the core expects the cartridge byte-swapped as in flash
+    for (size_t i = 0; i < rom.size(); i += 2) {
+        const uint8_t temp = rom[i];
+        rom[i] = rom[i + 1];
+        rom[i + 1] = temp;
+    }
+
+    memset(gwenesis_sn76489_buffer, 0, sizeof(gwenesis_sn76489_buffer));
+
+    load_cartridge((uintptr_t) rom.data());
+    power_on();
+    reset_emulation();
+    gwenesis_vdp_set_buffer((uint8_t *) SCREEN);
+
+    if (cpu_only) {
+        cpu_benchmark(frames);
+        return 0;
+    }
+    if (z80_only) {
+        z80_benchmark(frames);
+        return 0;
+    }
+
+    int frames_skipped_total = 0;
+#if GWENESIS_PERF
+    uint64_t perf_total[PERF_SLOTS] = {};
+#endif
+    uint64_t frame_min = UINT64_MAX, frame_max = 0;
+    // stands in for core 1 rendering queued lines
+    std::atomic<bool> running{true};
+    std::thread render_thread;
+    if (gwenesis_vdp_get_pipeline()) {
+        render_thread = std::thread([&running] {
+            while (running.load(std::memory_order_relaxed))
+                if (!gwenesis_vdp_pipeline_render())
+                    tight_loop_contents();
+        });
+    }
+#if GWENESIS_PROFILE
+    // stands in for the core 1 sampling timer
+    std::thread sample_thread;
+    if (samples_path) {
+        gwenesis_profile_reset();
+        gwenesis_profile_running = true;
+        sample_thread = std::thread([&running] {
+            while (running.load(std::memory_order_relaxed)) {
+                gwenesis_profile_sample();
+                const timespec period{0, 1000000000 / GWENESIS_PROFILE_HZ};
+                nanosleep(&period, nullptr);
+            }
+        });
+    }
+#endif
+
+    PERF_RESET();
+    const uint64_t start = time_ns();
+    for (int i = 0; i < frames; i++) {
+        const uint64_t frame_start = time_ns();
+        hash_lines = i == frames - 1;
+        emulate_frame();
+        frames_skipped_total += !drawFrame;
+        const uint64_t frame_time = time_ns() - frame_start;
+        if (frame_time < frame_min) frame_min = frame_time;
+        if (frame_time > frame_max) frame_max = frame_time;
+#if GWENESIS_PERF
+        for (int slot = 0; slot < PERF_SLOTS; slot++)
+            perf_total[slot] += gwenesis_perf_frame[slot];
+#endif
+    }
+    gwenesis_vdp_pipeline_sync();
+    const uint64_t total = time_ns() - start;
+
+    // stands in for the display scanning out the last frame
+#if GWENESIS_VDP_LINE_PALETTES
+    if (gwenesis_vdp_line_palettes)
+        for (unsigned int y = 0; y < screen_height; y++) {
+            gwenesis_vdp_palette_row(y);
+            hash_line_palette();
+        }
+#endif
+
+    running = false;
+    if (render_thread.joinable())
+        render_thread.join();
+#if GWENESIS_PROFILE
+    if (sample_thread.joinable())
+        sample_thread.join();
+#endif
+
+    printf("frames    : %d (%ux%u, z80 mode %d%s%s%s)\n", frames, screen_width, screen_height, z80_enable_mode,
+           frameskip ? ", frameskip" : "", gwenesis_vdp_get_pipeline() ? ", line pipeline" : "",
+           audio_enabled ? "" : ", no audio");
+    if (frameskip)
+        printf("skipped   : %d frames\n", frames_skipped_total - (int) gwenesis_vdp_frames_unchanged);
+    if (gwenesis_vdp_skip_unchanged)
+        printf("unchanged : %u frames not drawn again\n", gwenesis_vdp_frames_unchanged);
+    printf("total     : %.3f s\n", total / 1e9);
+    printf("fps       : %.1f\n", frames / (total / 1e9));
+    printf("frame ms  : avg %.3f min %.3f max %.3f\n", total / 1e6 / frames, frame_min / 1e6, frame_max / 1e6);
+    if (m68k_idle_skip)
+        printf("68K idle  : %u loops skipped, %.1f%% of 68K cycles\n", m68k_idle_hits,
+               100.0 * m68k_idle_cycles / ((double) frames * lines_per_frame * VDP_CYCLES_PER_LINE));
+    if (z80_idle_skip && z80_enable_mode)
+        printf("Z80 idle  : %u loops skipped, %.0f Z80 cycles per frame, %.1f%% of Z80 cycles\n", z80_idle_hits,
+               (double) z80_idle_cycles / Z80_FREQ_DIVISOR / frames,
+               100.0 * z80_idle_cycles / ((double) frames * lines_per_frame * VDP_CYCLES_PER_LINE));
+#if GWENESIS_PERF
+    static const char *const perf_labels[PERF_SLOTS] = {"other", "m68k", "z80", "vdp", "sound", "limiter"};
+    for (int slot = 0; slot < PERF_SLOTS; slot++)
+        printf("%-10s: %.3f ms/frame\n", perf_labels[slot], perf_total[slot] / 1e3 / frames);
+#endif
+#if M68K_FUSED_LOOPS
+    if (m68k_fused_loops)
+        printf("68K fused : %u DBF loop passes\n", m68k_fused_passes);
+#endif
+    printf("checksum  : %08x\n", screen_checksum());
+    printf("palette   : %08x\n", palette_checksum());
+    printf("lines     : %08x\n", lines_hash);
+    if (profile_path && !write_profile(profile_path, frames))
+        return 1;
+    if (samples_path && !write_samples(samples_path, rom_path ? rom_path : "built-in test program"))
+        return 1;
+    return 0;
+}
@@ -56,7 +56,7 @@ void bus_log(const char *subs, const char *fmt, ...) {
   printf("\n");
 }
 #else
-#define bus_log(...)
+#define bus_log(...) do {} while(0)
 #endif
 
 // Setup M68k memories ROM & RAM
@@ -71,6 +71,11 @@ unsigned char M68K_RAM[MAX_RAM_SIZE]; // 68K RAM
 //unsigned char* ZRAM = NULL; // Z80 RAM
 unsigned char ZRAM[MAX_Z80_RAM_SIZE]; // Z80 RAM
 unsigned char TMSS[0x4];
+
+// 68K address space pages: direct pointers and mapped_address of each page
+m68k_page_t m68k_pages[0x100];
+static unsigned char bus_page_map[0x100];
+
 extern unsigned short gwenesis_vdp_status;
 
 extern int audio_enabled;
@@ -85,8 +90,29 @@ int tmss_count = 0;
  *
  ******************************************************************************/
 
+static void gwenesis_bus_map_pages() {
+    memset(m68k_pages, 0, sizeof(m68k_pages));
+    memset(bus_page_map, NONE, sizeof(bus_page_map));
+
+    //        ROM ADDRESS 0x000000 - 0x7FFFFF
+    for (int page = 0; page < 0x80; page++) {
+        m68k_pages[page].read = &ROM_DATA[page << 16];
+        bus_page_map[page] = ROM_ADDR;
+    }
+    // Z80 ADDRESS 0xA00000 - 0xA0FFFF
+    bus_page_map[0xA0] = Z80_PAGE;
+    //                  IO ADDRESS  0xA10000 - 0xA1FFFF
+    bus_page_map[0xA1] = IO_PAGE;
+    // VDP ADDRESS 0xC00000 - 0xC0FFFF
+    bus_page_map[0xC0] = VDP_ADDR;
+    // RAM ADDRESS 0xFF0000 - 0xFFFFFF
+    m68k_pages[0xFF].read = m68k_pages[0xFF].write = M68K_RAM;
+    bus_page_map[0xFF] = RAM_ADDR;
+}
+
 void load_cartridge(uintptr_t rom) {
     ROM_DATA = (const unsigned char *)rom;
+    gwenesis_bus_map_pages();
     // Clear all volatile memory
     memset(M68K_RAM, 0, MAX_RAM_SIZE);
     memset(ZRAM, 0, MAX_Z80_RAM_SIZE);
@@ -311,26 +337,18 @@ static inline unsigned int gwenesis_bus_map_io_address(unsigned int address) {
 
 static inline
 unsigned int gwenesis_bus_map_address(unsigned int address) {
-    // Mask address page
-    unsigned int range = (address & 0xFF0000) >> 16;
+    // Select memory type from the address page
+    const unsigned int map = bus_page_map[(address >> 16) & 0xFF];
 
-    // Check mask and select memory type
-    if (range < 0x80) //        ROM ADDRESS 0x000000 - 0x3FFFFF
-        return ROM_ADDR;
-    if (range == 0xA0) // Z80 ADDRESS 0xA00000 - 0xA0FFFF
+    if (map == Z80_PAGE)
         return gwenesis_bus_map_z80_address(address);
-    if (range == 0xA1) //                  IO ADDRESS  0xA10000 - 0xA1FFFF
+    if (map == IO_PAGE)
         return gwenesis_bus_map_io_address(address);
-    if (range == 0xC0) // VDP ADDRESS 0xC00000 - 0xDFFFFFF
-        return VDP_ADDR;
-    if (range == 0xFF) // RAM ADDRESS 0xE00000 - 0xFFFFFFF
-        return RAM_ADDR;
-
 
     // If not a valid address return 0
-    bus_log(__FUNCTION__, "M68K > ?? unnmap address %x", address);
-    //assert(0);
-    return NONE;
+    if (map == NONE)
+        bus_log(__FUNCTION__, "M68K > ?? unnmap address %x", address);
+    return map;
 }
 
 /******************************************************************************
@@ -556,10 +574,12 @@ static inline void gwenesis_bus_write_memory_16(unsigned int address,
  *
  *   68K CPU read address R8
  *   Read an address from memory mapped and return value as byte
+ *   ROM and RAM pages are read directly, other pages through the bus
  *
  ******************************************************************************/
 unsigned int m68k_read_memory_8(unsigned int address) {
-    //  if ((address &  0xFF0000 ) == 0xFF0000) return FETCH8RAM(address);
+    const unsigned char* page = M68K_PAGE(address).read;
+    if (page) return page[M68K_PAGE_OFFSET(address) ^ 1];
     return gwenesis_bus_read_memory_8(address);
 }
 
@@ -570,7 +590,8 @@ unsigned int m68k_read_memory_8(unsigned int address) {
  *
  ******************************************************************************/
 unsigned int m68k_read_memory_16(unsigned int address) {
-    //   if ((address &  0xFF0000 ) == 0xFF0000) return FETCH16RAM(address);
+    const unsigned char* page = M68K_PAGE(address).read;
+    if (page) return *(unsigned short*) (page + M68K_PAGE_OFFSET(address));
     return gwenesis_bus_read_memory_16(address);
 }
 
@@ -581,8 +602,7 @@ unsigned int m68k_read_memory_16(unsigned int address) {
  *
  ******************************************************************************/
 unsigned int m68k_read_memory_32(unsigned int address) {
-    //  if ((address &  0xFF0000 ) == 0xFF0000) return FETCH32RAM(address);
-    return (gwenesis_bus_read_memory_16(address) << 16) | gwenesis_bus_read_memory_16(address + 2);
+    return (m68k_read_memory_16(address) << 16) | m68k_read_memory_16(address + 2);
 }
 
 /******************************************************************************
@@ -592,10 +612,11 @@ unsigned int m68k_read_memory_32(unsigned int address) {
  *
  ******************************************************************************/
 void m68k_write_memory_8(unsigned int address, unsigned int value) {
-    // if ((address & 0xFF0000) == 0xFF0000) {
-    //   WRITE8RAM(address, value);
-    //   return;
-    // }
+    unsigned char* page = M68K_PAGE(address).write;
+    if (page) {
+        page[M68K_PAGE_OFFSET(address) ^ 1] = value;
+        return;
+    }
     gwenesis_bus_write_memory_8(address, value);
     return;
 }
@@ -607,10 +628,11 @@ void m68k_write_memory_8(unsigned int address, unsigned int value) {
  *
  ******************************************************************************/
 void m68k_write_memory_16(unsigned int address, unsigned int value) {
-    // if ((address & 0xFF0000) == 0xFF0000) {
-    //   WRITE16RAM(address, value);
-    //   return;
-    // }
+    unsigned char* page = M68K_PAGE(address).write;
+    if (page) {
+        *(unsigned short*) (page + M68K_PAGE_OFFSET(address)) = value;
+        return;
+    }
     gwenesis_bus_write_memory_16(address, value);
     return;
 }
@@ -622,12 +644,8 @@ void m68k_write_memory_16(unsigned int address, unsigned int value) {
  *
  ******************************************************************************/
 void m68k_write_memory_32(unsigned int address, unsigned int value) {
-    // if ((address & 0xFF0000) == 0xFF0000) {
-    //   WRITE32RAM(address, value);
-    //   return;
-    // }
-    gwenesis_bus_write_memory_16(address, (value >> 16) & 0xffff);
-    gwenesis_bus_write_memory_16(address + 2, (value) & 0xffff);
+    m68k_write_memory_16(address, (value >> 16) & 0xffff);
+    m68k_write_memory_16(address + 2, (value) & 0xffff);
 
     return;
 }
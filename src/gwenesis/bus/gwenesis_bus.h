@@ -71,7 +71,9 @@ enum mapped_address
     Z80_CTRL,
     TMSS_CTRL,
     VDP_ADDR,
-    RAM_ADDR
+    RAM_ADDR,
+    Z80_PAGE, // 64KB pages mapped further by address
+    IO_PAGE
 };
 
 enum gwenesis_bus_pad_button
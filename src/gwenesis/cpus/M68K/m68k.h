@@ -158,7 +158,7 @@ extern const unsigned char *ROM_METADATA;
 extern unsigned char M68K_RAM[];
 
 // ROM needs to be converted for this to work!
-#define FETCH8ROM(A)    (unsigned char)  ROM_DATA[ A^1 ]
+#define FETCH8ROM(A)    (unsigned char)  ROM_DATA[ (A)^1 ]
 #define FETCH16ROM(A)  ( (unsigned short)  (*((unsigned short *) &ROM_DATA[A])) )
 #define FETCH32ROM(A) ( (*(unsigned short *)(&ROM_DATA[(A+2)])) | ((*(unsigned short *)(&ROM_DATA[A])) << 16))
 
@@ -172,6 +172,19 @@ extern unsigned char M68K_RAM[];
 #define WRITE32RAM(A, V)  ( *((unsigned short *) &M68K_RAM[  A      & 0XFFFF ]) = V >> 16); \
                           ( *((unsigned short *) &M68K_RAM[ (A + 2) & 0XFFFF ]) = V & 0xffff); \
 
+/* 68K address space in 64KB pages, set up by load_cartridge.
+ * ROM and RAM pages point straight at their (byte swapped) memory, NULL
+ * pages go through the m68k_read/write_memory handlers. */
+typedef struct {
+    const unsigned char* read;
+    unsigned char* write;
+} m68k_page_t;
+
+extern m68k_page_t m68k_pages[0x100];
+
+#define M68K_PAGE(A)        (m68k_pages[((A) >> 16) & 0xFF])
+#define M68K_PAGE_OFFSET(A) ((A) & 0xFFFF)
+
 #define m68k_read_immediate_16(A) ( ( (A) & 0x800000) ? FETCH16RAM((A)) : FETCH16ROM((A)) )
 #define m68k_read_immediate_32(A) ( ( (A) & 0x800000) ? FETCH32RAM((A)) : FETCH32ROM((A)) )
 
@@ -293,6 +306,11 @@ typedef struct
   unsigned int pc;
   unsigned int cycle;
   unsigned int detected;
+  unsigned int areg_mask;  /* address registers the polled addresses were computed from */
+  unsigned int areg[8];    /* and their values then */
+  unsigned int code_pc;    /* loop running from RAM: its words, absolute addresses included, */
+  unsigned int code_words; /* 0 when it runs from ROM */
+  unsigned short code[9];  /* IDLE_LOOP_MAX_BYTES / 2 + 1 */
 } cpu_idle_t;
 
 typedef struct
@@ -306,6 +324,8 @@ typedef struct
 
   unsigned int dar[16];         /* Data and Address Registers */
   unsigned int pc;              /* Program Counter */
+  const unsigned char *fetch_base; /* Host memory of the region the PC is in */
+  unsigned int fetch_mask;      /* PC bits addressing fetch_base */
   unsigned int sp[5];           /* User and Interrupt Stack Pointers */
   unsigned int ir;              /* Instruction Register */
   unsigned int t1_flag;         /* Trace 1 */
@@ -424,6 +444,9 @@ extern void m68k_run(unsigned int cycles);
 /* Get current instruction execution time */
 extern int m68k_cycles(void);
 
+/* Bytes of opcode dispatch tables (jump and cycle tables, or their compact form) */
+extern unsigned int m68k_dispatch_bytes(void);
+
 /* Number of cycles run so far from start of frame */
 extern int m68k_cycles_master(void);
 
@@ -438,6 +461,28 @@ extern void m68k_set_irq(unsigned int int_level);
 extern void m68k_set_irq_delay(unsigned int int_level);
 extern void m68k_update_irq(unsigned int mask);
 
+/* Idle loop skipping: runtime switch, loops skipped and master cycles saved */
+extern int m68k_idle_skip;
+extern unsigned int m68k_idle_hits;
+extern unsigned int m68k_idle_cycles;
+
+/* Fused DBF loops: runtime switch and passes run fused */
+extern int m68k_fused_loops;
+extern unsigned int m68k_fused_passes;
+
+/* Opcode profile: executions per opcode, and per pair of consecutive
+ * opcodes (first << 16 | second) in an open addressed table
+ */
+typedef struct
+{
+  unsigned int pair;
+  unsigned int hits;
+} m68k_opcode_pair_t;
+
+extern unsigned int m68k_opcode_hits[0x10000];
+extern m68k_opcode_pair_t m68k_opcode_pairs[];
+extern unsigned int m68k_opcode_pairs_lost;
+
 /* Halt the CPU as if you pulsed the HALT pin. */
 extern void m68k_pulse_halt(void);
 extern void m68k_clear_halt(void);
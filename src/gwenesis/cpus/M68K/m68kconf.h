@@ -64,6 +64,45 @@
  */
 #define M68K_EMULATE_ADDRESS_ERROR  OPT_ON
 
+/* If ON, opcodes are dispatched through a two level table built at init
+ * from the jump and cycle tables: 1024 opcode groups (IR >> 6) point to
+ * shared 64 entry blocks (the EA field) of indexes into the unique handler
+ * and cycle arrays. About 38KB in RAM instead of reading the 256KB pointer
+ * table and 64KB cycle table from XIP flash on every instruction.
+ * Off by default, that RAM is a seventh of the RP2040 SRAM: enabled by the
+ * M68K_COMPACT_DISPATCH build option.
+ */
+#ifndef M68K_COMPACT_DISPATCH
+#define M68K_COMPACT_DISPATCH       OPT_OFF
+#endif
+#define M68K_COMPACT_BLOCKS         224   /* unique 64 opcode blocks, 217 used */
+#define M68K_COMPACT_HANDLERS       1728  /* unique handler/cycles pairs, 1702 used */
+
+/* If ON, DBF loops over a single instruction copying or filling memory
+ * (move (Ay)+,(Ax)+, move Dy,(Ax)+, clr (Ay)+) run their passes in one
+ * fused handler. The DBF entries of the jump table point to it, so both
+ * dispatches get it. m68k_fused_loops switches it at runtime.
+ */
+#ifndef M68K_FUSED_LOOPS
+#define M68K_FUSED_LOOPS            OPT_ON
+#endif
+
+/* If ON, every executed opcode and pair of consecutive opcodes is counted
+ * in m68k_opcode_hits and m68k_opcode_pairs (M68K_OPCODE_PAIRS entries,
+ * power of 2). Host profiling only.
+ */
+#ifndef M68K_OPCODE_PROFILE
+#define M68K_OPCODE_PROFILE         OPT_OFF
+#endif
+#define M68K_OPCODE_PAIRS           0x10000
+
+/* If ON, a short backward Bcc.s/BRA.s loop that only polls work RAM or the
+ * VDP status register is recognised on its second pass, and the CPU skips
+ * to the end of the current m68k_run slice, as nothing it reads can change
+ * before then. m68k_idle_skip switches it at runtime.
+ */
+#define M68K_IDLE_LOOPS             OPT_ON
+
 /* If ON and previous option is also ON, address error exceptions will
    also be checked when fetching instructions. Disabling this can help
    speeding up emulation while still emulating address error exceptions
@@ -12,6 +12,10 @@ extern int vdp_68k_irq_ack(int int_level);
 /* ================================ INCLUDES ============================== */
 /* ======================================================================== */
 
+#include <string.h>
+
+#include "m68kconf.h"
+
 #ifndef BUILD_TABLES
   #ifndef TABLES_FULL
     #include "m68ki_cycles.h"
@@ -20,7 +24,15 @@ extern int vdp_68k_irq_ack(int int_level);
   #endif
 #endif
 
-#include "m68kconf.h"
+#if M68K_COMPACT_DISPATCH
+/* Two level opcode dispatch, see m68ki_build_compact_tables() */
+static unsigned short m68ki_compact_group[0x400];                      /* IR >> 6 -> block offset */
+static unsigned short m68ki_compact_leaf[M68K_COMPACT_BLOCKS << 6];   /* block + (IR & 0x3f) -> index */
+static void (*m68ki_compact_handlers[M68K_COMPACT_HANDLERS])(void);
+static unsigned char m68ki_compact_cycles[M68K_COMPACT_HANDLERS];
+static uint m68ki_compact_blocks, m68ki_compact_count;
+#endif
+
 #include "m68kcpu.h"
 #include "m68kops.h"
 #include "../../savestate/gwenesis_savestate.h"
@@ -38,6 +50,38 @@ static int irq_latency;
 
 m68ki_cpu_core m68k;
 
+#if M68K_OPCODE_PROFILE
+unsigned int m68k_opcode_hits[0x10000];
+m68k_opcode_pair_t m68k_opcode_pairs[M68K_OPCODE_PAIRS];
+unsigned int m68k_opcode_pairs_lost;   /* pairs not counted, table full */
+
+static uint m68ki_profile_prev;
+
+INLINE void m68ki_profile_opcode(uint ir)
+{
+  const uint pair = (m68ki_profile_prev << 16) | ir;
+  uint i = (pair * 2654435761u) >> 16;
+  uint probe;
+
+  m68k_opcode_hits[ir]++;
+  m68ki_profile_prev = ir;
+
+  for (probe = 0; probe < 16; probe++, i++)
+  {
+    m68k_opcode_pair_t *entry = &m68k_opcode_pairs[i & (M68K_OPCODE_PAIRS - 1)];
+
+    if (entry->hits && entry->pair != pair)
+      continue;
+    entry->pair = pair;
+    entry->hits++;
+    return;
+  }
+  m68k_opcode_pairs_lost++;
+}
+#else
+#define m68ki_profile_opcode(ir)
+#endif
+
 
 /* ======================================================================== */
 /* =============================== CALLBACKS ============================== */
@@ -51,6 +95,7 @@ m68ki_cpu_core m68k;
 /* Interrupt acknowledge */
 static int default_int_ack_callback(int int_level)
 {
+  (void)int_level;
   CPU_INT_LEVEL = 0;
   return M68K_INT_ACK_AUTOVECTOR;
 }
@@ -237,14 +282,15 @@ void m68k_set_irq_delay(unsigned int int_level)
     if ((REG_IR & 0xF000) != 0x2000)
     {
       /* Finish executing current instruction */
-      USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+      USE_CYCLES(m68ki_opcode_cycles(REG_IR));
 
       /* One instruction delay before interrupt */
       irq_latency = 1;
       m68ki_trace_t1() /* auto-disable (see m68kcpu.h) */
       m68ki_use_data_space() /* auto-disable (see m68kcpu.h) */
       REG_IR = m68ki_read_imm_16();
-      m68ki_instruction_jump_table[REG_IR]();
+      m68ki_profile_opcode(REG_IR);
+      m68ki_opcode_handler(REG_IR)();
       m68ki_exception_if_trace() /* auto-disable (see m68kcpu.h) */
       irq_latency = 0;
     }
@@ -308,19 +354,488 @@ void __time_critical_func(m68k_run)(unsigned int cycles)
     REG_IR = m68ki_read_imm_16();
 
 //    printf("PC=%x IR=%x CYCLES=%d \n",m68k.pc,REG_IR,CYC_INSTRUCTION[REG_IR]);
+    m68ki_profile_opcode(REG_IR);
+
     /* Execute instruction */
-    m68ki_instruction_jump_table[REG_IR]();
-    USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+    m68ki_opcode_handler(REG_IR)();
+    USE_CYCLES(m68ki_opcode_cycles(REG_IR));
     /* Trace m68k_exception, if necessary */
     m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
   }
 }
 
+#if M68K_IDLE_LOOPS
+/* ======================================================================== */
+/* ============================== IDLE LOOPS ============================== */
+/* ======================================================================== */
+
+/* A polling loop is a straight run of TST, BTST #n, CMPI, ANDI #n,Dn and
+ * MOVE <mem>,Dn closed by a backward Bcc.s/BRA.s. It only changes flags
+ * and data registers reloaded from memory, so every pass behaves the same
+ * until what it reads changes. Within a run slice nothing else writes work
+ * RAM (interrupts, Z80 and DMA happen between slices) and of the VDP status
+ * only HBLANK moves.
+ */
+int m68k_idle_skip = 1;
+unsigned int m68k_idle_hits;
+unsigned int m68k_idle_cycles;
+
+#define IDLE_LOOP_MAX_BYTES  16
+#define IDLE_LOOP_MAX_CYCLES (64 * MUL) /* one pass, master cycles */
+#define IDLE_VDP_HBLANK      0x0004     /* VDP status bit that moves within a line */
+
+static const uint idle_size_mask[3] = { 0xFF, 0xFFFF, 0xFFFFFFFF };
+
+/* Address of a memory operand, pc past its extension words, the address
+ * register it depends on added to areg_mask. 0 for modes a polling loop
+ * does not use.
+ */
+static int idle_loop_ea(uint ea, uint *pc, uint *address, uint *areg_mask)
+{
+  const uint reg = ea & 7;
+
+  switch (ea >> 3)
+  {
+    case 2: /* (An) */
+      *address = REG_A[reg];
+      *areg_mask |= 1 << reg;
+      return 1;
+    case 5: /* d16(An) */
+      *address = REG_A[reg] + MAKE_INT_16(m68ki_fetch_16(*pc));
+      *areg_mask |= 1 << reg;
+      *pc += 2;
+      return 1;
+    case 7:
+      if (reg == 0) /* abs.w */
+      {
+        *address = MAKE_INT_16(m68ki_fetch_16(*pc));
+        *pc += 2;
+        return 1;
+      }
+      if (reg == 1) /* abs.l */
+      {
+        *address = m68ki_fetch_16(*pc) << 16 | m68ki_fetch_16(*pc + 2);
+        *pc += 4;
+        return 1;
+      }
+      return 0;
+    default:
+      return 0;
+  }
+}
+
+/* Memory the loop may poll: work RAM, or the VDP status port as long as the
+ * bits deciding the branch do not include HBLANK.
+ */
+static int idle_loop_source(uint address, uint size, uint mask, int decides)
+{
+  address = ADDRESS_68K(address);
+
+  if (M68K_PAGE(address).write)
+    return 1;
+
+  if ((address >> 16) == 0xC0 && (address & 0x1C) == 0x04)
+  {
+    uint status_bits = mask;
+
+    if (size == 0)
+      status_bits = (address & 1) ? mask : mask << 8;
+    else if (size == 2)
+      status_bits = mask | mask >> 16;
+
+    return !decides || !(status_bits & IDLE_VDP_HBLANK);
+  }
+  return 0;
+}
+
+/* Check the loop from target up to the branch at branch_pc */
+static int idle_loop_detect(uint target, uint branch_pc)
+{
+  uint read_address[IDLE_LOOP_MAX_BYTES / 2], read_size[IDLE_LOOP_MAX_BYTES / 2];
+  int reads = 0;
+  int reg_read[8] = { -1, -1, -1, -1, -1, -1, -1, -1 }; /* Dn loaded by read # */
+  uint reg_mask[8];                                     /* bits of the read kept in Dn */
+  int flag_read = -1;                                   /* read deciding the branch */
+  uint flag_mask = 0;
+  uint areg_mask = 0;
+  uint pc = target;
+
+  if (branch_pc - target > IDLE_LOOP_MAX_BYTES)
+    return 0;
+
+  while (pc < branch_pc)
+  {
+    const uint op = m68ki_fetch_16(pc);
+    const uint ea = op & 0x3F;
+    uint size = (op >> 6) & 3;
+    uint address, imm = 0;
+
+    pc += 2;
+
+    if ((op & 0xFF00) == 0x4A00 && size != 3)          /* TST <ea> */
+      imm = idle_size_mask[size];
+    else if ((op & 0xFFC0) == 0x0800)                  /* BTST #n,<ea> */
+    {
+      imm = 1 << (m68ki_fetch_16(pc) & ((ea >> 3) ? 7 : 31));
+      size = 0;
+      pc += 2;
+    }
+    else if ((op & 0xFF00) == 0x0C00 && size != 3)     /* CMPI #n,<ea> */
+    {
+      imm = idle_size_mask[size];
+      pc += (size == 2) ? 4 : 2;
+    }
+    else if ((op & 0xFF38) == 0x0200 && size != 3)     /* ANDI #n,Dn */
+    {
+      imm = (size == 2) ? (m68ki_fetch_16(pc) << 16 | m68ki_fetch_16(pc + 2)) : m68ki_fetch_16(pc);
+      pc += (size == 2) ? 4 : 2;
+      if (reg_read[ea & 7] < 0)
+        return 0;
+      reg_mask[ea & 7] &= imm;
+    }
+    else if ((op & 0xC1C0) == 0 && (op & 0x3000))      /* MOVE <mem>,Dn */
+    {
+      static const uint move_size[4] = { 0, 0, 2, 1 };
+      const uint reg = (op >> 9) & 7;
+
+      size = move_size[op >> 12];
+      if (!idle_loop_ea(ea, &pc, &address, &areg_mask))
+        return 0;
+      read_address[reads] = address;
+      read_size[reads] = size;
+      reg_read[reg] = reads;
+      reg_mask[reg] = idle_size_mask[size];
+      flag_read = reads++;
+      flag_mask = idle_size_mask[size];
+      continue;
+    }
+    else
+      return 0;
+
+    if ((ea >> 3) == 0)
+    {
+      /* on a data register: decided by the read it was loaded from, if any */
+      const uint reg = ea & 7;
+
+      flag_read = reg_read[reg];
+      flag_mask = (flag_read < 0) ? 0 : (imm & reg_mask[reg]);
+    }
+    else
+    {
+      if (!idle_loop_ea(ea, &pc, &address, &areg_mask))
+        return 0;
+      read_address[reads] = address;
+      read_size[reads] = size;
+      flag_read = reads++;
+      flag_mask = imm;
+    }
+  }
+  if (pc != branch_pc)
+    return 0;
+
+  for (int i = 0; i < reads; i++)
+    if (!idle_loop_source(read_address[i], read_size[i], flag_mask, i == flag_read))
+      return 0;
+
+  m68ki_cpu.poll.areg_mask = areg_mask;
+  for (int i = 0; i < 8; i++)
+    m68ki_cpu.poll.areg[i] = REG_A[i];
+
+  m68ki_cpu.poll.code_pc = target;
+  m68ki_cpu.poll.code_words = 0;
+  if (M68K_PAGE(target).write || M68K_PAGE(branch_pc).write)
+  {
+    m68ki_cpu.poll.code_words = (branch_pc - target) / 2 + 1;
+    for (uint i = 0; i < m68ki_cpu.poll.code_words; i++)
+      m68ki_cpu.poll.code[i] = m68ki_fetch_16(target + i * 2);
+  }
+  return 1;
+}
+
+/* The polled addresses are still the ones checked: same address registers
+ * and, for a loop in RAM, same code */
+static int idle_loop_same_sources(void)
+{
+  uint mask = m68ki_cpu.poll.areg_mask;
+
+  while (mask)
+  {
+    const int reg = __builtin_ctz(mask);
+
+    mask &= mask - 1;
+    if (REG_A[reg] != m68ki_cpu.poll.areg[reg])
+      return 0;
+  }
+  for (uint i = 0; i < m68ki_cpu.poll.code_words; i++)
+    if (m68ki_fetch_16(m68ki_cpu.poll.code_pc + i * 2) != m68ki_cpu.poll.code[i])
+      return 0;
+  return 1;
+}
+
+/* Called on every backward short branch taken. The first pass of a loop is
+ * analysed; on the next pass, if it polls, the rest of the slice is skipped.
+ * A loop entered again with other address registers, or rewritten in RAM,
+ * is analysed again, as its reads may now go elsewhere.
+ */
+void m68ki_idle_loop_check(uint branch_pc)
+{
+  const uint since = m68ki_cpu.cycles - m68ki_cpu.poll.cycle;
+
+  m68ki_cpu.poll.cycle = m68ki_cpu.cycles;
+
+  if (branch_pc != m68ki_cpu.poll.pc || since > IDLE_LOOP_MAX_CYCLES ||
+      (m68ki_cpu.poll.detected && !idle_loop_same_sources()))
+  {
+    m68ki_cpu.poll.pc = branch_pc;
+    m68ki_cpu.poll.detected = (REG_IR & 0xFF00) != 0x6100 && idle_loop_detect(REG_PC, branch_pc);
+    return;
+  }
+
+  if (m68ki_cpu.poll.detected && m68ki_cpu.cycles < m68ki_cpu.cycle_end)
+  {
+    m68k_idle_hits++;
+    m68k_idle_cycles += m68ki_cpu.cycle_end - m68ki_cpu.cycles;
+    m68ki_cpu.cycles = m68ki_cpu.cycle_end;
+  }
+}
+#endif
+
+#if M68K_FUSED_LOOPS
+/* ======================================================================== */
+/* ============================= FUSED LOOPS ============================== */
+/* ======================================================================== */
+
+/* DBF over a single word instruction (body: op; dbf Dn,body) that copies or
+ * fills memory. Once the DBF is taken, further passes run here without
+ * fetching and dispatching both instructions, with the same cycles and
+ * slice boundary. A pass is only run while both accesses hit work RAM or
+ * ROM pages, aligned, and the counter does not expire; anything else is
+ * left to the plain handlers.
+ */
+int m68k_fused_loops = 1;
+unsigned int m68k_fused_passes;
+
+enum
+{
+  FUSED_NONE,
+  FUSED_MOVE_PI_PI,   /* move.w/l (Ay)+,(Ax)+ */
+  FUSED_MOVE_D_PI,    /* move.w/l Dy,(Ax)+ */
+  FUSED_CLR_PI        /* clr.w/l (Ay)+ */
+};
+
+static int fused_loop_kind(uint ir, uint *size)
+{
+  switch (ir & 0xf1f8)
+  {
+    case 0x30d8: *size = 2; return FUSED_MOVE_PI_PI;
+    case 0x20d8: *size = 4; return FUSED_MOVE_PI_PI;
+    case 0x30c0: *size = 2; return FUSED_MOVE_D_PI;
+    case 0x20c0: *size = 4; return FUSED_MOVE_D_PI;
+  }
+  switch (ir & 0xfff8)
+  {
+    case 0x4258: *size = 2; return FUSED_CLR_PI;
+    case 0x4298: *size = 4; return FUSED_CLR_PI;
+  }
+  return FUSED_NONE;
+}
+
+/* Aligned and directly mapped for the whole access */
+static int fused_loop_page(uint address, uint size, int write)
+{
+  const m68k_page_t *page = &M68K_PAGE(address);
+
+  if ((address & 1) || M68K_PAGE_OFFSET(address) > 0x10000 - size)
+    return 0;
+  return (write ? page->write : page->read) != NULL;
+}
+
+static void m68ki_op_dbf_fused(void)
+{
+  const uint body_pc = REG_PC - 4;
+  const uint dbf_ir = REG_IR;
+  uint *r_cnt = &DY;
+  uint ir, kind, size, pending, body_cycles;
+  uint *ay, *ax;
+
+  m68k_op_dbf_16();
+
+  if (REG_PC != body_pc || !m68k_fused_loops)
+    return;
+
+  ir = m68ki_fetch_16(body_pc);
+  kind = fused_loop_kind(ir, &size);
+  if (kind == FUSED_NONE)
+    return;
+
+  ay = &REG_A[ir & 7];
+  ax = &REG_A[(ir >> 9) & 7];
+  pending = m68ki_opcode_cycles(dbf_ir);
+  body_cycles = m68ki_opcode_cycles(ir);
+
+  /* stop before the pass that expires the counter */
+  while (MASK_OUT_ABOVE_16(*r_cnt))
+  {
+    const uint cycles = m68ki_cpu.cycles;
+    uint src = 0, dst, value;
+
+    /* body and DBF must both start before the end of the slice */
+    USE_CYCLES(pending);
+    USE_CYCLES(body_cycles);
+    if (m68ki_cpu.cycles >= m68ki_cpu.cycle_end)
+    {
+      m68ki_cpu.cycles = cycles;
+      return;
+    }
+
+    if (kind == FUSED_MOVE_PI_PI)
+    {
+      src = *ay;
+      dst = (ax == ay) ? src + size : *ax;
+      if (!fused_loop_page(src, size, 0) || !fused_loop_page(dst, size, 1))
+      {
+        m68ki_cpu.cycles = cycles;
+        return;
+      }
+    }
+    else
+    {
+      dst = (kind == FUSED_CLR_PI) ? *ay : *ax;
+      if (!fused_loop_page(dst, size, 1))
+      {
+        m68ki_cpu.cycles = cycles;
+        return;
+      }
+    }
+
+    switch (kind)
+    {
+      case FUSED_MOVE_PI_PI:
+        value = (size == 2) ? m68ki_read_16(src) : m68ki_read_32(src);
+        *ay += size;
+        *ax += size;
+        break;
+      case FUSED_MOVE_D_PI:
+        value = (size == 2) ? MASK_OUT_ABOVE_16(REG_D[ir & 7]) : REG_D[ir & 7];
+        *ax += size;
+        break;
+      default:
+        value = 0;
+        *ay += size;
+        break;
+    }
+    if (size == 2)
+    {
+      m68ki_write_16(dst, value);
+      FLAG_N = NFLAG_16(value);
+    }
+    else
+    {
+      m68ki_write_32(dst, value);
+      FLAG_N = NFLAG_32(value);
+    }
+    FLAG_Z = value;
+    FLAG_V = VFLAG_CLEAR;
+    FLAG_C = CFLAG_CLEAR;
+
+    /* DBF taken again */
+    *r_cnt = MASK_OUT_BELOW_16(*r_cnt) | MASK_OUT_ABOVE_16(*r_cnt - 1);
+    USE_CYCLES(CYC_DBCC_F_NOEXP);
+    m68k_fused_passes++;
+  }
+}
+#endif
+
 int m68k_cycles(void)
 {
-  return CYC_INSTRUCTION[REG_IR];
+  return m68ki_opcode_cycles(REG_IR);
+}
+
+unsigned int m68k_dispatch_bytes(void)
+{
+#if M68K_COMPACT_DISPATCH
+  return sizeof(m68ki_compact_group) + (m68ki_compact_blocks << 6) * sizeof(m68ki_compact_leaf[0]) +
+         m68ki_compact_count * (sizeof(m68ki_compact_handlers[0]) + sizeof(m68ki_compact_cycles[0]));
+#else
+  return sizeof(m68ki_instruction_jump_table) + sizeof(m68ki_cycles);
+#endif
 }
 
+#if M68K_COMPACT_DISPATCH
+/* Line F opcodes past the end of the short jump table */
+static void m68ki_op_1111(void)
+{
+  m68ki_exception_1111();
+}
+
+/* Build the two level dispatch from the jump and cycle tables. Opcodes are
+ * split in 1024 groups of 64 (the EA field): every group is turned into
+ * 64 indexes in the unique (handler, cycles) pairs, and groups with the
+ * same indexes share one block. Identical neighbours and a small hash of
+ * the handler address keep the pair lookup short.
+ */
+static void m68ki_build_compact_tables(void)
+{
+  const uint size = sizeof(m68ki_instruction_jump_table) / sizeof(m68ki_instruction_jump_table[0]);
+  unsigned short hint[256];
+  unsigned short block[64];
+  uint group, i, j;
+
+  memset(hint, 0, sizeof(hint));
+  m68ki_compact_blocks = 0;
+  m68ki_compact_count = 0;
+
+  for (group = 0; group < 0x400; group++)
+  {
+    for (i = 0; i < 64; i++)
+    {
+      uint ir = (group << 6) | i;
+      void (*handler)(void) = m68k_op_illegal;
+      unsigned char cycles = 0;
+      unsigned short *h;
+
+      if (ir < size)
+      {
+        handler = m68ki_instruction_jump_table[ir];
+        cycles = CYC_INSTRUCTION[ir];
+      }
+      else if ((ir & 0xf000) == 0xf000)
+      {
+        handler = m68ki_op_1111;
+        cycles = 4*MUL;
+      }
+
+      h = &hint[((unsigned long)handler >> 2) & 0xff];
+      j = *h;
+      if (j >= m68ki_compact_count || m68ki_compact_handlers[j] != handler || m68ki_compact_cycles[j] != cycles)
+      {
+        for (j = 0; j < m68ki_compact_count; j++)
+          if (m68ki_compact_handlers[j] == handler && m68ki_compact_cycles[j] == cycles)
+            break;
+        if (j == m68ki_compact_count)
+        {
+          m68ki_compact_handlers[j] = handler;
+          m68ki_compact_cycles[j] = cycles;
+          m68ki_compact_count++;
+        }
+        *h = j;
+      }
+      block[i] = j;
+    }
+
+    for (j = 0; j < m68ki_compact_blocks; j++)
+      if (!memcmp(&m68ki_compact_leaf[j << 6], block, sizeof(block)))
+        break;
+    if (j == m68ki_compact_blocks)
+    {
+      memcpy(&m68ki_compact_leaf[j << 6], block, sizeof(block));
+      m68ki_compact_blocks++;
+    }
+    m68ki_compact_group[group] = j << 6;
+  }
+}
+#endif
+
 int __always_inline m68k_cycles_run(void)
 {
 	return m68k.cycle_end - m68k.cycles;
@@ -344,6 +859,11 @@ void m68k_init(void)
   }
 #endif
 
+#if M68K_COMPACT_DISPATCH
+  if (!m68ki_compact_count)
+    m68ki_build_compact_tables();
+#endif
+
 #ifdef M68K_OVERCLOCK_SHIFT
   m68k.cycle_ratio = 1 << M68K_OVERCLOCK_SHIFT;
 #endif
@@ -437,7 +957,7 @@ void gwenesis_m68k_load_state() {
   saveGwenesisStateGetBuffer(state, "REG_D", REG_D, sizeof(REG_D));
 
   m68ki_set_sr(saveGwenesisStateGet(state, "SR"));
-  REG_PC = saveGwenesisStateGet(state, "REG_PC");
+  m68ki_jump(saveGwenesisStateGet(state, "REG_PC"));
   REG_SP = saveGwenesisStateGet(state, "REG_SP");
   REG_USP = saveGwenesisStateGet(state, "REG_USP");
   REG_ISP = saveGwenesisStateGet(state, "REG_ISP");
@@ -214,6 +214,14 @@
 #endif
 
 #define CYC_INSTRUCTION   m68ki_cycles
+#if M68K_COMPACT_DISPATCH
+#define m68ki_opcode_index(A)    m68ki_compact_leaf[m68ki_compact_group[(A) >> 6] + ((A) & 0x3f)]
+#define m68ki_opcode_handler(A)  m68ki_compact_handlers[m68ki_opcode_index(A)]
+#define m68ki_opcode_cycles(A)   m68ki_compact_cycles[m68ki_opcode_index(A)]
+#else
+#define m68ki_opcode_handler(A)  m68ki_instruction_jump_table[A]
+#define m68ki_opcode_cycles(A)   CYC_INSTRUCTION[A]
+#endif
 #define CYC_EXCEPTION     m68ki_exception_cycle_table
 #define CYC_BCC_NOTAKE_B  ( -2 * MUL)
 #define CYC_BCC_NOTAKE_W  (  2 * MUL)
@@ -750,6 +758,7 @@ INLINE void m68ki_jump_vector(uint vector);
 INLINE void m68ki_branch_8(uint offset);
 INLINE void m68ki_branch_16(uint offset);
 INLINE void m68ki_branch_32(uint offset);
+void m68ki_idle_loop_check(uint branch_pc);
 
 /* Status register operations. */
 INLINE void m68ki_set_s_flag(uint value);            /* Only bit 2 of value should be set (i.e. 4 or 0) */
@@ -784,6 +793,23 @@ INLINE void m68ki_check_interrupts(void);            /* ASG: check for interrupt
 
 /* ---------------------------- Read Immediate ---------------------------- */
 
+/* Opcodes and extension words are fetched through a host pointer to the
+ * region holding the PC: cartridge ROM, or work RAM for 0x800000-0xFFFFFF.
+ * It only changes when the PC is loaded (jumps, exceptions, reset).
+ */
+INLINE void m68ki_set_fetch_region(uint pc)
+{
+  if (pc & 0x800000) {
+    m68ki_cpu.fetch_base = M68K_RAM;
+    m68ki_cpu.fetch_mask = 0xFFFF;
+  } else {
+    m68ki_cpu.fetch_base = ROM_DATA;
+    m68ki_cpu.fetch_mask = 0x7FFFFF;
+  }
+}
+
+#define m68ki_fetch_16(A) (*(const unsigned short *)(m68ki_cpu.fetch_base + ((A) & m68ki_cpu.fetch_mask)))
+
 /* Handles all immediate reads, does address error check, function code setting,
  * and prefetching if they are enabled in m68kconf.h
  */
@@ -804,7 +830,7 @@ INLINE uint m68ki_read_imm_16(void)
 #else
   uint pc = REG_PC;
   REG_PC += 2;
-  return m68k_read_immediate_16(pc);
+  return m68ki_fetch_16(pc);
 #endif /* M68K_EMULATE_PREFETCH */
 }
 
@@ -840,7 +866,7 @@ INLINE uint m68ki_read_imm_32(void)
 #endif
   uint pc = REG_PC;
   REG_PC += 4;
-  return m68k_read_immediate_32(pc);
+  return (m68ki_fetch_16(pc) << 16) | m68ki_fetch_16(pc + 2);
 #endif /* M68K_EMULATE_PREFETCH */
 }
 
@@ -858,63 +884,69 @@ INLINE uint m68ki_read_imm_32(void)
 
 INLINE uint m68ki_read_8(uint address)
 {
+  const unsigned char *page = M68K_PAGE(address).read;
 
   m68ki_set_fc(FLAG_S | m68ki_get_address_space()) /* auto-disable (see m68kcpu.h) */
 
-	if (ADDRESS_68K(address) <  0x800000) return FETCH8ROM(ADDRESS_68K(address));
-	if (ADDRESS_68K(address) >= 0xFF0000) return FETCH8RAM(ADDRESS_68K(address));
-	return m68k_read_memory_8(ADDRESS_68K(address));
-
+  if (page) return page[M68K_PAGE_OFFSET(address) ^ 1];
+  return m68k_read_memory_8(ADDRESS_68K(address));
 }
 
 INLINE uint m68ki_read_16(uint address)
 {
+  const unsigned char *page = M68K_PAGE(address).read;
 
   m68ki_set_fc(FLAG_S | m68ki_get_address_space()) /* auto-disable (see m68kcpu.h) */
- 
- 	if (ADDRESS_68K(address) <  0x800000) return FETCH16ROM(ADDRESS_68K(address));
-	if (ADDRESS_68K(address) >= 0xFF0000) return FETCH16RAM(ADDRESS_68K(address));
-	return m68k_read_memory_16(ADDRESS_68K(address));
 
+  if (page) return *(unsigned short *)(page + M68K_PAGE_OFFSET(address));
+  return m68k_read_memory_16(ADDRESS_68K(address));
 }
 
 INLINE uint m68ki_read_32(uint address)
 {
+  const unsigned char *page = M68K_PAGE(address).read;
+  const uint offset = M68K_PAGE_OFFSET(address);
 
   m68ki_set_fc(FLAG_S | m68ki_get_address_space()) /* auto-disable (see m68kcpu.h) */
-	if (ADDRESS_68K(address) <  0x800000) return FETCH32ROM(ADDRESS_68K(address));
-	if (ADDRESS_68K(address) >= 0xFF0000) return FETCH32RAM(ADDRESS_68K(address));
-	return m68k_read_memory_32(ADDRESS_68K(address));
+
+  /* the last word of a page leaves it */
+  if (page && offset != 0xFFFE)
+    return (*(unsigned short *)(page + offset) << 16) | *(unsigned short *)(page + offset + 2);
+  return m68k_read_memory_32(ADDRESS_68K(address));
 }
 
 INLINE void m68ki_write_8(uint address, uint value)
 {
+  unsigned char *page = M68K_PAGE(address).write;
 
   m68ki_set_fc(FLAG_S | FUNCTION_CODE_USER_DATA) /* auto-disable (see m68kcpu.h) */
-        if (ADDRESS_68K(address) >= 0xFF0000) {
-          WRITE8RAM(ADDRESS_68K(address), value);
-        } else
-        m68k_write_memory_8(ADDRESS_68K(address), value);
+
+  if (page) page[M68K_PAGE_OFFSET(address) ^ 1] = value;
+  else m68k_write_memory_8(ADDRESS_68K(address), value);
 }
 
 INLINE void m68ki_write_16(uint address, uint value)
 {
+  unsigned char *page = M68K_PAGE(address).write;
 
   m68ki_set_fc(FLAG_S | FUNCTION_CODE_USER_DATA) /* auto-disable (see m68kcpu.h) */
-        if (ADDRESS_68K(address) >= 0xFF0000) {
-          WRITE16RAM(ADDRESS_68K(address), value);
-        } else
-	m68k_write_memory_16(ADDRESS_68K(address), value);
+
+  if (page) *(unsigned short *)(page + M68K_PAGE_OFFSET(address)) = value;
+  else m68k_write_memory_16(ADDRESS_68K(address), value);
 }
 
 INLINE void m68ki_write_32(uint address, uint value)
 {
+  unsigned char *page = M68K_PAGE(address).write;
+  const uint offset = M68K_PAGE_OFFSET(address);
 
   m68ki_set_fc(FLAG_S | FUNCTION_CODE_USER_DATA) /* auto-disable (see m68kcpu.h) */
-        if (ADDRESS_68K(address) >= 0xFF0000) {
-          WRITE32RAM(ADDRESS_68K(address), value);
-        } else
-	m68k_write_memory_32(ADDRESS_68K(address), value);
+
+  if (page && offset != 0xFFFE) {
+    *(unsigned short *)(page + offset) = value >> 16;
+    *(unsigned short *)(page + offset + 2) = value;
+  }
+  else m68k_write_memory_32(ADDRESS_68K(address), value);
 }
 
 
@@ -1201,12 +1233,13 @@ INLINE uint m68ki_pull_32(void)
 INLINE void m68ki_jump(uint new_pc)
 {
   REG_PC = new_pc;
+  m68ki_set_fetch_region(new_pc);
 }
 
 INLINE void m68ki_jump_vector(uint vector)
 {
   m68ki_use_data_space() /* auto-disable (see m68kcpu.h) */
-  REG_PC = m68ki_read_32(vector<<2);
+  m68ki_jump(m68ki_read_32(vector<<2));
 }
 
 
@@ -1218,6 +1251,11 @@ INLINE void m68ki_jump_vector(uint vector)
 INLINE void m68ki_branch_8(uint offset)
 {
   REG_PC += MAKE_INT_8(offset);
+#if M68K_IDLE_LOOPS
+  /* Backward short branch: may close a polling loop */
+  if ((offset & 0x80) && m68k_idle_skip)
+    m68ki_idle_loop_check(REG_PC - MAKE_INT_8(offset) - 2);
+#endif
 }
 
 INLINE void m68ki_branch_16(uint offset)
@@ -1375,7 +1413,7 @@ static void m68ki_exception_privilege_violation(void)
   m68ki_jump_vector(EXCEPTION_PRIVILEGE_VIOLATION);
 
   /* Use up some clock cycles and undo the instruction's cycles */
-  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_PRIVILEGE_VIOLATION] - CYC_INSTRUCTION[REG_IR]);
+  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_PRIVILEGE_VIOLATION] - m68ki_opcode_cycles(REG_IR));
 }
 
 /* Exception for A-Line instructions */
@@ -1386,7 +1424,7 @@ INLINE void m68ki_exception_1010(void)
   m68ki_jump_vector(EXCEPTION_1010);
 
   /* Use up some clock cycles and undo the instruction's cycles */
-  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_1010] - CYC_INSTRUCTION[REG_IR]);
+  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_1010] - m68ki_opcode_cycles(REG_IR));
 }
 
 /* Exception for F-Line instructions */
@@ -1397,7 +1435,7 @@ INLINE void m68ki_exception_1111(void)
   m68ki_jump_vector(EXCEPTION_1111);
 
   /* Use up some clock cycles and undo the instruction's cycles */
-  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_1111] - CYC_INSTRUCTION[REG_IR]);
+  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_1111] - m68ki_opcode_cycles(REG_IR));
 }
 
 /* Exception for illegal instructions */
@@ -1413,7 +1451,7 @@ INLINE void m68ki_exception_illegal(void)
   m68ki_jump_vector(EXCEPTION_ILLEGAL_INSTRUCTION);
 
   /* Use up some clock cycles and undo the instruction's cycles */
-  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_ILLEGAL_INSTRUCTION] - CYC_INSTRUCTION[REG_IR]);
+  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_ILLEGAL_INSTRUCTION] - m68ki_opcode_cycles(REG_IR));
 }
 
 
@@ -1430,7 +1468,7 @@ INLINE void m68ki_exception_address_error(void)
   if(CPU_RUN_MODE == RUN_MODE_BERR_AERR_RESET)
   {
     CPU_STOPPED = STOP_LEVEL_HALT;
-    SET_CYCLES(m68ki_cpu.cycle_end - CYC_INSTRUCTION[REG_IR]);
+    SET_CYCLES(m68ki_cpu.cycle_end - m68ki_opcode_cycles(REG_IR));
     return;
   }
   CPU_RUN_MODE = RUN_MODE_BERR_AERR_RESET;
@@ -1441,7 +1479,7 @@ INLINE void m68ki_exception_address_error(void)
   m68ki_jump_vector(EXCEPTION_ADDRESS_ERROR);
 
   /* Use up some clock cycles and undo the instruction's cycles */
-  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_ADDRESS_ERROR] - CYC_INSTRUCTION[REG_IR]);
+  USE_CYCLES(CYC_EXCEPTION[EXCEPTION_ADDRESS_ERROR] - m68ki_opcode_cycles(REG_IR));
 }
 #endif
 
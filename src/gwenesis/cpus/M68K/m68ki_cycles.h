@@ -1,4 +1,9 @@
+#if M68K_COMPACT_DISPATCH
+/* only read once to build the compact dispatch, keep it in flash */
+static const unsigned char m68ki_cycles[] =
+#else
 static unsigned char m68ki_cycles[] =
+#endif
 {
     8*7,   8*7,   8*7,   8*7,   8*7,   8*7,   8*7,   8*7,   0*7,   0*7,   0*7,   0*7,   0*7,   0*7,   0*7,   0*7, 
    16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7,  16*7, 
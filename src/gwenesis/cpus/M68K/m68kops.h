@@ -23672,11 +23672,17 @@ static void __inline m68k_op_unlk_32(void)
 
 #ifndef BUILD_TABLES
 
+  #if M68K_FUSED_LOOPS
+    /* the tables are const, DBF is routed to the fused handler here */
+    static void m68ki_op_dbf_fused(void);
+    #define m68k_op_dbf_16 m68ki_op_dbf_fused
+  #endif
   #ifndef TABLES_FULL
     #include "m68ki_instruction_jump_table.h"
   #else
     #include "m68ki_instruction_jump_table_full.h"
   #endif
+  #undef m68k_op_dbf_16
 #else
 
 /* This is used to generate the opcode handler jump table */
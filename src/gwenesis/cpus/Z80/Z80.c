@@ -62,8 +62,30 @@ INLINE byte OpZ80(word A) { return(RAM[A>>13][A&0x1FFF]); }
 
 #ifdef GENESIS
 #define FAST_RDOP
-extern byte *Z80_RAM[];
-INLINE byte OpZ80(word A) { return(Z80_RAM[A>>13][A&0x1FFF]); }
+extern byte *Z80_RAM;
+/* 8kB RAM and its mirror below 4000h are accessed in place, */
+/* the rest of the map goes to the RdZ80()/WrZ80() handlers. */
+INLINE byte OpZ80(word A)
+{ return(A<0x4000? Z80_RAM[A&0x1FFF]:RdZ80(A)); }
+INLINE void WrZ80RAM(word A,byte V)
+{ if(A<0x4000) Z80_RAM[A&0x1FFF]=V; else WrZ80(A,V); }
+#define RdZ80 OpZ80
+#define WrZ80 WrZ80RAM
+#endif
+
+/** Z80_THREADED *********************************************/
+/** With GCC, ExecZ80() jumps to the main opcode handlers   **/
+/** through a table of label addresses instead of a switch. **/
+/** Each OP() in Codes.h is both a case and a label.        **/
+/*************************************************************/
+#if !defined(Z80_THREADED) && defined(__GNUC__)
+#define Z80_THREADED 1
+#endif
+
+#if Z80_THREADED
+#define OP(N) case N: op_##N
+#else
+#define OP(N) case N
 #endif
 
 /** FAST_RDOP ************************************************/
@@ -132,8 +154,19 @@ INLINE byte OpZ80(word A) { return(Z80_RAM[A>>13][A&0x1FFF]); }
   R->PC.W=J.W; \
   JumpZ80(J.W)
 
+#ifdef IDLEZ80
+#define M_JP  \
+  J.B.l=OpZ80(R->PC.W++);J.B.h=OpZ80(R->PC.W);  \
+  if(J.W<R->PC.W-1) IdleZ80(R,J.W,R->PC.W-2);    \
+  R->PC.W=J.W;JumpZ80(J.W)
+#define M_JR  \
+  J.W=R->PC.W+(offset)OpZ80(R->PC.W)+1;          \
+  if(J.W<R->PC.W) IdleZ80(R,J.W,R->PC.W-1);      \
+  R->PC.W=J.W;JumpZ80(J.W)
+#else
 #define M_JP  J.B.l=OpZ80(R->PC.W++);J.B.h=OpZ80(R->PC.W);R->PC.W=J.W;JumpZ80(J.W)
 #define M_JR  R->PC.W+=(offset)OpZ80(R->PC.W)+1;JumpZ80(R->PC.W)
+#endif
 #define M_RET R->PC.B.l=OpZ80(R->SP.W++);R->PC.B.h=OpZ80(R->SP.W++);JumpZ80(R->PC.W)
 
 #define M_RST(Ad)      \
@@ -518,10 +551,53 @@ int GetRunCyclesZ80(register Z80 *R)
 }
 int ExecZ80(register Z80 *R,register int RunCycles)
 {
+#if Z80_THREADED
+  static const void *const Ops[256] =
+  {
+    &&op_NOP,&&op_LD_BC_WORD,&&op_LD_xBC_A,&&op_INC_BC,&&op_INC_B,&&op_DEC_B,&&op_LD_B_BYTE,&&op_RLCA,
+    &&op_EX_AF_AF,&&op_ADD_HL_BC,&&op_LD_A_xBC,&&op_DEC_BC,&&op_INC_C,&&op_DEC_C,&&op_LD_C_BYTE,&&op_RRCA,
+    &&op_DJNZ,&&op_LD_DE_WORD,&&op_LD_xDE_A,&&op_INC_DE,&&op_INC_D,&&op_DEC_D,&&op_LD_D_BYTE,&&op_RLA,
+    &&op_JR,&&op_ADD_HL_DE,&&op_LD_A_xDE,&&op_DEC_DE,&&op_INC_E,&&op_DEC_E,&&op_LD_E_BYTE,&&op_RRA,
+    &&op_JR_NZ,&&op_LD_HL_WORD,&&op_LD_xWORD_HL,&&op_INC_HL,&&op_INC_H,&&op_DEC_H,&&op_LD_H_BYTE,&&op_DAA,
+    &&op_JR_Z,&&op_ADD_HL_HL,&&op_LD_HL_xWORD,&&op_DEC_HL,&&op_INC_L,&&op_DEC_L,&&op_LD_L_BYTE,&&op_CPL,
+    &&op_JR_NC,&&op_LD_SP_WORD,&&op_LD_xWORD_A,&&op_INC_SP,&&op_INC_xHL,&&op_DEC_xHL,&&op_LD_xHL_BYTE,&&op_SCF,
+    &&op_JR_C,&&op_ADD_HL_SP,&&op_LD_A_xWORD,&&op_DEC_SP,&&op_INC_A,&&op_DEC_A,&&op_LD_A_BYTE,&&op_CCF,
+    &&op_LD_B_B,&&op_LD_B_C,&&op_LD_B_D,&&op_LD_B_E,&&op_LD_B_H,&&op_LD_B_L,&&op_LD_B_xHL,&&op_LD_B_A,
+    &&op_LD_C_B,&&op_LD_C_C,&&op_LD_C_D,&&op_LD_C_E,&&op_LD_C_H,&&op_LD_C_L,&&op_LD_C_xHL,&&op_LD_C_A,
+    &&op_LD_D_B,&&op_LD_D_C,&&op_LD_D_D,&&op_LD_D_E,&&op_LD_D_H,&&op_LD_D_L,&&op_LD_D_xHL,&&op_LD_D_A,
+    &&op_LD_E_B,&&op_LD_E_C,&&op_LD_E_D,&&op_LD_E_E,&&op_LD_E_H,&&op_LD_E_L,&&op_LD_E_xHL,&&op_LD_E_A,
+    &&op_LD_H_B,&&op_LD_H_C,&&op_LD_H_D,&&op_LD_H_E,&&op_LD_H_H,&&op_LD_H_L,&&op_LD_H_xHL,&&op_LD_H_A,
+    &&op_LD_L_B,&&op_LD_L_C,&&op_LD_L_D,&&op_LD_L_E,&&op_LD_L_H,&&op_LD_L_L,&&op_LD_L_xHL,&&op_LD_L_A,
+    &&op_LD_xHL_B,&&op_LD_xHL_C,&&op_LD_xHL_D,&&op_LD_xHL_E,&&op_LD_xHL_H,&&op_LD_xHL_L,&&op_HALT,&&op_LD_xHL_A,
+    &&op_LD_A_B,&&op_LD_A_C,&&op_LD_A_D,&&op_LD_A_E,&&op_LD_A_H,&&op_LD_A_L,&&op_LD_A_xHL,&&op_LD_A_A,
+    &&op_ADD_B,&&op_ADD_C,&&op_ADD_D,&&op_ADD_E,&&op_ADD_H,&&op_ADD_L,&&op_ADD_xHL,&&op_ADD_A,
+    &&op_ADC_B,&&op_ADC_C,&&op_ADC_D,&&op_ADC_E,&&op_ADC_H,&&op_ADC_L,&&op_ADC_xHL,&&op_ADC_A,
+    &&op_SUB_B,&&op_SUB_C,&&op_SUB_D,&&op_SUB_E,&&op_SUB_H,&&op_SUB_L,&&op_SUB_xHL,&&op_SUB_A,
+    &&op_SBC_B,&&op_SBC_C,&&op_SBC_D,&&op_SBC_E,&&op_SBC_H,&&op_SBC_L,&&op_SBC_xHL,&&op_SBC_A,
+    &&op_AND_B,&&op_AND_C,&&op_AND_D,&&op_AND_E,&&op_AND_H,&&op_AND_L,&&op_AND_xHL,&&op_AND_A,
+    &&op_XOR_B,&&op_XOR_C,&&op_XOR_D,&&op_XOR_E,&&op_XOR_H,&&op_XOR_L,&&op_XOR_xHL,&&op_XOR_A,
+    &&op_OR_B,&&op_OR_C,&&op_OR_D,&&op_OR_E,&&op_OR_H,&&op_OR_L,&&op_OR_xHL,&&op_OR_A,
+    &&op_CP_B,&&op_CP_C,&&op_CP_D,&&op_CP_E,&&op_CP_H,&&op_CP_L,&&op_CP_xHL,&&op_CP_A,
+    &&op_RET_NZ,&&op_POP_BC,&&op_JP_NZ,&&op_JP,&&op_CALL_NZ,&&op_PUSH_BC,&&op_ADD_BYTE,&&op_RST00,
+    &&op_RET_Z,&&op_RET,&&op_JP_Z,&&op_PFX_CB,&&op_CALL_Z,&&op_CALL,&&op_ADC_BYTE,&&op_RST08,
+    &&op_RET_NC,&&op_POP_DE,&&op_JP_NC,&&op_OUTA,&&op_CALL_NC,&&op_PUSH_DE,&&op_SUB_BYTE,&&op_RST10,
+    &&op_RET_C,&&op_EXX,&&op_JP_C,&&op_INA,&&op_CALL_C,&&op_PFX_DD,&&op_SBC_BYTE,&&op_RST18,
+    &&op_RET_PO,&&op_POP_HL,&&op_JP_PO,&&op_EX_HL_xSP,&&op_CALL_PO,&&op_PUSH_HL,&&op_AND_BYTE,&&op_RST20,
+    &&op_RET_PE,&&op_LD_PC_HL,&&op_JP_PE,&&op_EX_DE_HL,&&op_CALL_PE,&&op_PFX_ED,&&op_XOR_BYTE,&&op_RST28,
+    &&op_RET_P,&&op_POP_AF,&&op_JP_P,&&op_DI,&&op_CALL_P,&&op_PUSH_AF,&&op_OR_BYTE,&&op_RST30,
+    &&op_RET_M,&&op_LD_SP_HL,&&op_JP_M,&&op_EI,&&op_CALL_M,&&op_PFX_FD,&&op_CP_BYTE,&&op_RST38
+  };
+#endif
   register byte I;
   register pair J;
+  register int IRQ;
   R->RunCycles = R->ICount;
 
+  /* IRequest only changes between calls: when no interrupt  */
+  /* is pending, nothing has to be checked between opcodes   */
+  /* but the end of EI, and the opcodes run back to back.    */
+  IRQ=(R->IRequest!=INT_NONE)&&(R->IRequest!=INT_QUIT);
+
   for(R->ICount=RunCycles;;)
   {
     while(R->ICount>0)
@@ -540,20 +616,27 @@ int ExecZ80(register Z80 *R,register int RunCycles)
       R->ICount-=Cycles[I];
 
       /* Interpret opcode */
+#if Z80_THREADED
+      goto *Ops[I];
+#endif
       switch(I)
       {
 #include "Codes.h"
-        case PFX_CB: CodesCB(R);break;
-        case PFX_ED: CodesED(R);break;
-        case PFX_FD: CodesFD(R);break;
-        case PFX_DD: CodesDD(R);break;
+        OP(PFX_CB): CodesCB(R);break;
+        OP(PFX_ED): CodesED(R);break;
+        OP(PFX_FD): CodesFD(R);break;
+        OP(PFX_DD): CodesDD(R);break;
       }
 
       /* Unless we have come here after EI, exit */
       if(!(R->IFF&IFF_EI))
       {
         /* Interrupt CPU if needed */
-        if((R->IRequest!=INT_NONE)&&(R->IRequest!=INT_QUIT)) IntZ80(R,R->IRequest);
+        if(IRQ)
+        {
+          IntZ80(R,R->IRequest);
+          IRQ=(R->IRequest!=INT_NONE)&&(R->IRequest!=INT_QUIT);
+        }
       }
       else
       {
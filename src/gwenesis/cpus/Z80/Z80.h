@@ -22,6 +22,7 @@ extern "C" {
 #define LSB_FIRST              /* Compile for low-endian CPU */
 /* #define MSB_FIRST */        /* Compile for hi-endian CPU  */
 #define EXECZ80
+#define IDLEZ80                /* Report backward JR/JP      */
 
                                /* LoopZ80() may return:      */
 #define INT_RST00   0x00C7     /* RST 00h                    */
@@ -186,6 +187,16 @@ word LoopZ80(register Z80 *R);
 void JumpZ80(word PC);
 #endif
 
+/** IdleZ80() ************************************************/
+/** Z80 emulation calls this function when a JR or JP jumps **/
+/** back to Target from Branch, with the cycles of the jump **/
+/** already taken off ICount. It may take more cycles off   **/
+/** to skip passes of a loop that polls memory.             **/
+/************************************ TO BE WRITTEN BY USER **/
+#ifdef IDLEZ80
+void IdleZ80(register Z80 *R,register word Target,register word Branch);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
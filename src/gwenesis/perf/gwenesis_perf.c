@@ -0,0 +1,46 @@
+/*
+Gwenesis : Genesis & megadrive Emulator.
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "bzhxx"
+__contact__ = "https://github.com/bzhxx"
+__license__ = "GPLv3"
+
+*/
+#pragma GCC optimize("Ofast")
+
+#include <string.h>
+#include "gwenesis_perf.h"
+
+#if GWENESIS_PERF
+uint32_t gwenesis_perf_time[PERF_SLOTS];
+uint32_t gwenesis_perf_frame[PERF_SLOTS];
+uint32_t gwenesis_perf_stamp;
+int gwenesis_perf_slot = PERF_OTHER;
+
+/* Start counting from now, in the unattributed slot */
+void gwenesis_perf_reset() {
+    memset(gwenesis_perf_time, 0, sizeof(gwenesis_perf_time));
+    memset(gwenesis_perf_frame, 0, sizeof(gwenesis_perf_frame));
+    gwenesis_perf_slot = PERF_OTHER;
+    gwenesis_perf_stamp = time_us_32();
+}
+
+/* Publish the counters of the frame just finished and start a new one */
+void gwenesis_perf_end_frame() {
+    gwenesis_perf_switch(gwenesis_perf_slot);
+    memcpy(gwenesis_perf_frame, gwenesis_perf_time, sizeof(gwenesis_perf_frame));
+    memset(gwenesis_perf_time, 0, sizeof(gwenesis_perf_time));
+}
+#elif GWENESIS_PROFILE
+int gwenesis_perf_slot = PERF_OTHER;
+#endif
@@ -0,0 +1,89 @@
+/*
+Gwenesis : Genesis & megadrive Emulator.
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "bzhxx"
+__contact__ = "https://github.com/bzhxx"
+__license__ = "GPLv3"
+
+*/
+#ifndef _gwenesis_perf_H_
+#define _gwenesis_perf_H_
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Per-subsystem frame time accounting.
+ *
+ * The emulation thread is always "in" exactly one slot; switching slots
+ * charges the elapsed time to the slot being left, so nested sections
+ * (sound generated from a CPU write) are not counted twice.
+ * Everything compiles to nothing unless GWENESIS_PERF is defined; with
+ * GWENESIS_PROFILE alone only the current slot is kept.
+ */
+enum gwenesis_perf_slot {
+    PERF_OTHER,   /* frame loop glue, not attributed */
+    PERF_M68K,    /* m68k_run */
+    PERF_Z80,     /* z80_run */
+    PERF_VDP,     /* gwenesis_vdp_render_line */
+    PERF_SOUND,   /* SN76489 / YM2612 sample generation on core 0 */
+    PERF_LIMITER, /* frame limiter wait */
+    PERF_SLOTS
+};
+
+#if GWENESIS_PERF
+#include <hardware/timer.h>
+
+extern uint32_t gwenesis_perf_time[PERF_SLOTS];  /* us spent in the running frame */
+extern uint32_t gwenesis_perf_frame[PERF_SLOTS]; /* us spent in the last completed frame */
+extern uint32_t gwenesis_perf_stamp;
+extern int gwenesis_perf_slot;
+
+static inline int gwenesis_perf_switch(const int slot) {
+    const uint32_t now = time_us_32();
+    const int previous = gwenesis_perf_slot;
+    gwenesis_perf_time[previous] += now - gwenesis_perf_stamp;
+    gwenesis_perf_stamp = now;
+    gwenesis_perf_slot = slot;
+    return previous;
+}
+
+void gwenesis_perf_reset();
+void gwenesis_perf_end_frame();
+
+/* Top level: leave the current slot for another one */
+#define PERF_SWITCH(slot) gwenesis_perf_switch(slot)
+/* Nested: enter a slot and return to the caller's slot with PERF_LEAVE */
+#define PERF_ENTER(slot) const int perf_previous_slot = gwenesis_perf_switch(slot)
+#define PERF_LEAVE() gwenesis_perf_switch(perf_previous_slot)
+#define PERF_RESET() gwenesis_perf_reset()
+#define PERF_END_FRAME() gwenesis_perf_end_frame()
+#elif GWENESIS_PROFILE
+/* Only the current slot, read by the PC sampling profiler */
+extern int gwenesis_perf_slot;
+
+#define PERF_SWITCH(slot) (gwenesis_perf_slot = (slot))
+#define PERF_ENTER(slot) const int perf_previous_slot = gwenesis_perf_slot; gwenesis_perf_slot = (slot)
+#define PERF_LEAVE() (gwenesis_perf_slot = perf_previous_slot)
+#define PERF_RESET() (gwenesis_perf_slot = PERF_OTHER)
+#define PERF_END_FRAME()
+#else
+#define PERF_SWITCH(slot)
+#define PERF_ENTER(slot)
+#define PERF_LEAVE()
+#define PERF_RESET()
+#define PERF_END_FRAME()
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*
+Gwenesis : Genesis & megadrive Emulator.
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "bzhxx"
+__contact__ = "https://github.com/bzhxx"
+__license__ = "GPLv3"
+
+*/
+#pragma GCC optimize("Ofast")
+
+#include <stdio.h>
+#include <string.h>
+#include "pico.h"
+#include "gwenesis_profile.h"
+
+#if GWENESIS_PROFILE
+#include "../cpus/M68K/m68k.h"
+
+#define PROFILE_ENTRIES (1 << GWENESIS_PROFILE_BITS)
+#define PROFILE_PROBES  8
+
+typedef struct {
+    uint32_t pc;
+    uint32_t hits; /* 0: free */
+} profile_entry_t;
+
+static profile_entry_t profile_pcs[PROFILE_ENTRIES];
+static uint32_t profile_slots[PERF_SLOTS];
+static uint32_t profile_samples, profile_lost;
+
+volatile bool gwenesis_profile_running = false;
+
+/* Forget all samples, call with the sampler stopped */
+void gwenesis_profile_reset(void) {
+    memset(profile_pcs, 0, sizeof(profile_pcs));
+    memset(profile_slots, 0, sizeof(profile_slots));
+    profile_samples = 0;
+    profile_lost = 0;
+}
+
+/* From the timer: where is the emulation thread now */
+void __time_critical_func(gwenesis_profile_sample)(void) {
+    if (!gwenesis_profile_running)
+        return;
+
+    const int slot = gwenesis_perf_slot;
+    profile_samples++;
+    profile_slots[slot]++;
+    if (slot != PERF_M68K)
+        return;
+
+    const uint32_t pc = m68k.pc & 0xFFFFFF;
+    uint32_t i = (pc >> 1) * 2654435761u >> (32 - GWENESIS_PROFILE_BITS);
+    for (int probe = 0; probe < PROFILE_PROBES; probe++, i = (i + 1) & (PROFILE_ENTRIES - 1)) {
+        profile_entry_t* entry = &profile_pcs[i];
+        if (entry->hits == 0)
+            entry->pc = pc;
+        else if (entry->pc != pc)
+            continue;
+        entry->hits++;
+        return;
+    }
+    profile_lost++;
+}
+
+/* Slot shares, then the most sampled PCs, one line at a time. The table is
+ * left as is so sampling can go on.
+ */
+bool gwenesis_profile_write(const char* title, gwenesis_profile_writer write, void* context) {
+    static const char* const slot_labels[PERF_SLOTS] = { "other", "68K", "Z80", "VDP", "sound", "wait" };
+    const uint32_t samples = profile_samples ? profile_samples : 1;
+    const uint32_t m68k_samples = profile_slots[PERF_M68K] ? profile_slots[PERF_M68K] : 1;
+    char line[96];
+
+    snprintf(line, sizeof line, "# 68K PC samples: %s\n", title);
+    if (!write(context, line))
+        return false;
+    snprintf(line, sizeof line, "# %lu samples at %u Hz, %lu 68K samples of PCs not kept\n",
+             (unsigned long) profile_samples, GWENESIS_PROFILE_HZ, (unsigned long) profile_lost);
+    if (!write(context, line))
+        return false;
+    for (int slot = 0; slot < PERF_SLOTS; slot++) {
+        snprintf(line, sizeof line, "# %-6s %5.1f%%\n", slot_labels[slot], profile_slots[slot] * 100.0f / samples);
+        if (!write(context, line))
+            return false;
+    }
+    if (!write(context, "#\n#   pc      hits  % of 68K\n"))
+        return false;
+
+    // top entries by repeated selection, below the last one written
+    uint32_t last_hits = UINT32_MAX, last_pc = 0;
+    for (int rank = 0; rank < GWENESIS_PROFILE_TOP; rank++) {
+        const profile_entry_t* best = NULL;
+        for (int i = 0; i < PROFILE_ENTRIES; i++) {
+            const profile_entry_t* entry = &profile_pcs[i];
+            if (entry->hits == 0 || entry->hits > last_hits || (entry->hits == last_hits && entry->pc <= last_pc))
+                continue;
+            if (!best || entry->hits > best->hits || (entry->hits == best->hits && entry->pc < best->pc))
+                best = entry;
+        }
+        if (!best)
+            break;
+        last_hits = best->hits;
+        last_pc = best->pc;
+        snprintf(line, sizeof line, "  %06lx %7lu  %5.1f%%\n", (unsigned long) best->pc, (unsigned long) best->hits,
+                 best->hits * 100.0f / m68k_samples);
+        if (!write(context, line))
+            return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,53 @@
+/*
+Gwenesis : Genesis & megadrive Emulator.
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "bzhxx"
+__contact__ = "https://github.com/bzhxx"
+__license__ = "GPLv3"
+
+*/
+#ifndef _gwenesis_profile_H_
+#define _gwenesis_profile_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gwenesis_perf.h"
+
+/*
+ * 68K PC sampling profiler.
+ *
+ * A periodic timer on the other core calls gwenesis_profile_sample(), which
+ * records the perf slot the emulation thread is in and, when that is the
+ * 68K, the PC it is at. PCs are counted in a fixed open addressed table;
+ * samples of PCs that find no room are only counted as lost.
+ * Everything compiles to nothing unless GWENESIS_PROFILE is defined.
+ */
+#define GWENESIS_PROFILE_HZ      5000 /* samples per second */
+#define GWENESIS_PROFILE_BITS    9    /* 512 PCs kept */
+#define GWENESIS_PROFILE_TOP     100  /* PCs written out */
+
+#if GWENESIS_PROFILE
+extern volatile bool gwenesis_profile_running;
+
+/* Line sink for gwenesis_profile_write, false to stop */
+typedef bool (*gwenesis_profile_writer)(void* context, const char* line);
+
+void gwenesis_profile_reset(void);
+void gwenesis_profile_sample(void);
+bool gwenesis_profile_write(const char* title, gwenesis_profile_writer write, void* context);
+#endif
+
+#endif
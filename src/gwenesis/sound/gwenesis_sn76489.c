@@ -33,6 +33,7 @@
 #include <limits.h>
 #include "../bus/gwenesis_bus.h"
 #include "../sound/gwenesis_sn76489.h"
+#include "../perf/gwenesis_perf.h"
 
 #include <pico.h>
 
@@ -138,9 +139,7 @@ int gwenesis_SN76489_GetContextSize(void) {
 INLINE void gwenesis_SN76489_Update(INT16* buffer, int length) {
     int i, j;
 
-#pragma gcc unroll
     for (j = 0; j < length; j++) {
-#pragma gcc unroll(2)
         for (i = 0; i <= 2; ++i)
             if (gwenesis_SN76489.IntermediatePos[i] != LONG_MIN)
                 gwenesis_SN76489.Channels[i] = __mul_instruction(gwenesis_SN76489.IntermediatePos[i],
@@ -172,7 +171,6 @@ INLINE void gwenesis_SN76489_Update(INT16* buffer, int length) {
         else gwenesis_SN76489.ToneFreqVals[3] -= gwenesis_SN76489.NumClocksForSample;
 
         /* Tone channels: */
-#pragma gcc unroll(4)
         for (i = 0; i <= 2; ++i) {
             if (gwenesis_SN76489.ToneFreqVals[i] <= 0) {
                 /* If it gets below 0... */
@@ -229,7 +227,7 @@ INLINE void gwenesis_SN76489_Update(INT16* buffer, int length) {
 extern int scan_line;
 extern bool sn76489_enabled;
 
-void YM2612Update(uint16_t *buffer, int length);
+void YM2612Update(int16_t *buffer, int length);
 
 void gwenesis_SN76489_run(int target) {
     if (sn76489_clock >= target) return;
@@ -242,6 +240,7 @@ void gwenesis_SN76489_run(int target) {
         int16* buf = gwenesis_sn76489_buffer + sn76489_prev_index;
         int len = sn76489_index - sn76489_prev_index;
         if (sn76489_enabled) gwenesis_SN76489_Update(buf, len);
+        /* the FM samples too: callers on core 0 account both in PERF_SOUND */
         YM2612Update(buf, len);
         sn76489_clock = __mul_instruction(sn76489_index, gwenesis_SN76489.divisor);
     }
@@ -254,8 +253,11 @@ void gwenesis_SN76489_Write(int data, int target) {
     if (!audio_enabled)
         return;
 
-    if (snd_accurate == 1)
+    if (snd_accurate == 1) {
+        PERF_ENTER(PERF_SOUND);
         gwenesis_SN76489_run(target);
+        PERF_LEAVE();
+    }
 
     if (data & 0x80) {
         /* Latch/data byte  %1 cc t dddd */
@@ -43,6 +43,14 @@ unsigned char *Z80_RAM;
 
 static Z80 cpu;
 
+/* Last loop seen by IdleZ80() */
+static struct {
+    word target, branch;
+    word hl, bc, de, ix, iy; /* pointers the loop was checked with */
+    int icount; /* ICount at the previous pass */
+    int polls;
+} idle;
+
 void ResetZ80(register Z80 *R);
 
 #define Z80_INST_DISABLE_LOGGING 1
@@ -68,6 +76,10 @@ void z80_log(const char *subs, const char *fmt, ...) {
 
 // Bank register used by Z80 to access M68K Memory space 1 BANK=32KByte
 int Z80_BANK;
+// Byte swapped ROM behind the bank, NULL when it maps RAM or I/O
+static const unsigned char *zbank_rom;
+
+static void zbank_map(void);
 
 
 void z80_start() {
@@ -80,6 +92,7 @@ void z80_start() {
     reset_once=0;
     bus_ack=0;
     zclk=0;
+    zbank_map();
 }
 
 void z80_pulse_reset() {
@@ -102,6 +115,10 @@ current_timeslice = 0;
   if ((reset_once == 1) && (bus_ack == 0) && (reset == 0)) {
 
    // z80_log("z80_run", "%1d%1d%1d||zclk=%d,tgt=%d",reset_once, bus_ack, reset, zclk, target);
+    // a pass only counts within the slice, and the 68K may have rewritten the loop in between
+    idle.icount = 0;
+    idle.target = idle.branch = 0xFFFF;
+    idle.polls = 0;
     rem = ExecZ80(&cpu, current_timeslice / Z80_FREQ_DIVISOR);
 
   }
@@ -214,20 +231,34 @@ word z80_get_reg(int reg_i) {
 
 unsigned int zbankreg_mem_r8(unsigned int address)
 {
+    (void)address;
       z80_log(__FUNCTION__,"Z80 bank read pointer : %06x", Z80_BANK);
 
     return Z80_BANK;
 }
 
+// ROM banks are read straight from the cartridge, a 32KB bank never crosses a 68K page
+static void zbank_map(void) {
+  const unsigned int address = Z80_BANK << 15;
+
+  zbank_rom = (address < 0x800000) ? M68K_PAGE(address).read : NULL;
+  if (zbank_rom)
+    zbank_rom += M68K_PAGE_OFFSET(address);
+}
+
 static inline void zbankreg_mem_w8(unsigned int value) {
   Z80_BANK >>= 1;
   Z80_BANK |= (value & 1) << 8;
+  zbank_map();
   z80_log(__FUNCTION__,"Z80 bank points to: %06x", Z80_BANK << 15);
   return;
 }
 
 static inline unsigned int zbank_mem_r8(unsigned int address)
 {
+    if (zbank_rom)
+      return zbank_rom[(address & 0x7FFF) ^ 1];
+
     address &= 0x7FFF;
     address |= (Z80_BANK << 15);
 
@@ -263,9 +294,216 @@ void zvdp_mem_w8(unsigned int address, unsigned int value)
 
 word LoopZ80(register Z80 *R)
 {
+    (void)R;
     return 0;
 }
 
+/********************************************
+ * Z80 idle loops
+ ********************************************/
+
+/* A sound driver waiting for the 68K or for a YM2612 timer spins on a short
+ * loop of loads, tests and compares closed by a backward JR/JP. Every pass
+ * does the same until what it reads changes, and within a z80_run slice
+ * nothing else writes Z80 RAM (the 68K only gets the bus between slices)
+ * and the YM2612 status does not move (its timers advance in YM2612Update,
+ * on the audio side of the frame). Whole passes up to the end of the slice
+ * are skipped, the last partial pass runs as usual.
+ */
+int z80_idle_skip = 1;
+unsigned int z80_idle_hits;
+unsigned int z80_idle_cycles;
+
+#define IDLE_LOOP_MAX_BYTES  16
+#define IDLE_LOOP_MAX_CYCLES 64 /* one pass, Z80 cycles */
+
+/* Registers and flags a loop instruction reads and writes */
+enum {
+    IDLE_A = 1 << 0, IDLE_B = 1 << 1, IDLE_C = 1 << 2, IDLE_D = 1 << 3,
+    IDLE_E = 1 << 4, IDLE_H = 1 << 5, IDLE_L = 1 << 6,
+    IDLE_IX = 1 << 7, IDLE_IY = 1 << 8,
+    IDLE_CF = 1 << 9,  /* carry */
+    IDLE_XF = 1 << 10, /* all other flags */
+};
+
+/* Register field of an opcode, 6 is (HL) */
+static const unsigned short idle_reg[8] = { IDLE_B, IDLE_C, IDLE_D, IDLE_E, IDLE_H, IDLE_L, 0, IDLE_A };
+
+/* Polled memory must stay the same for the rest of the slice: Z80 RAM and
+ * the YM2612 status */
+static int idle_loop_source(word address) {
+    return address < 0x6000;
+}
+
+/* Check the loop from target up to the branch. Every pass must end in the
+ * same state: a register or flag read before it is written in the pass may
+ * not be written anywhere in the loop. */
+static int idle_loop_detect(Z80 *R, word target, word branch) {
+    unsigned int reads = 0, writes = 0;
+    word pc = target;
+
+    if (branch >= 0x4000 || branch - target > IDLE_LOOP_MAX_BYTES)
+        return 0;
+
+    const byte jump = Z80_RAM[branch & 0x1FFF];
+    if ((jump & 0xE7) != 0x20 && jump != 0x18 && (jump & 0xC7) != 0xC2 && jump != 0xC3)
+        return 0; /* JR cc, JR, JP cc, JP */
+
+    while (pc < branch) {
+        const byte op = Z80_RAM[pc++ & 0x1FFF];
+        unsigned int rd = 0, wr = 0;
+        word index = 0;
+        int address = -1;
+
+        if (op == 0xDD || op == 0xFD) {
+            /* ld r,(ix+d), alu a,(ix+d), bit n,(ix+d) */
+            const byte sub = Z80_RAM[pc & 0x1FFF];
+            const unsigned int xy = (op == 0xDD) ? IDLE_IX : IDLE_IY;
+
+            index = (op == 0xDD) ? R->IX.W : R->IY.W;
+            address = (word) (index + (offset) Z80_RAM[(pc + 1) & 0x1FFF]);
+            rd = xy;
+            if ((sub & 0xC7) == 0x46 && sub != 0x76) {
+                wr = idle_reg[(sub >> 3) & 7];
+                pc += 2;
+            } else if ((sub & 0xC7) == 0x86) {
+                const int alu = (sub >> 3) & 7;
+                rd |= IDLE_A | ((alu == 1 || alu == 3) ? IDLE_CF : 0);
+                wr = IDLE_CF | IDLE_XF | (alu == 7 ? 0 : IDLE_A);
+                pc += 2;
+            } else if (sub == 0xCB && (Z80_RAM[(pc + 2) & 0x1FFF] & 0xC7) == 0x46) {
+                wr = IDLE_XF;
+                pc += 3;
+            } else
+                return 0;
+        } else if (op == 0xCB) {
+            /* bit n,r / bit n,(hl) */
+            const byte sub = Z80_RAM[pc++ & 0x1FFF];
+            const int r = sub & 7;
+
+            if ((sub & 0xC0) != 0x40)
+                return 0;
+            if (r == 6) {
+                rd = IDLE_H | IDLE_L;
+                address = R->HL.W;
+            } else
+                rd = idle_reg[r];
+            wr = IDLE_XF;
+        } else if (op >= 0x40 && op < 0xC0) {
+            /* ld r,r' / ld r,(hl) and alu a,r / alu a,(hl) */
+            const int r = op & 7;
+
+            if (op >= 0x70 && op < 0x78)
+                return 0; /* ld (hl),r and halt */
+            if (r == 6) {
+                rd = IDLE_H | IDLE_L;
+                address = R->HL.W;
+            } else
+                rd = idle_reg[r];
+            if (op < 0x80)
+                wr = idle_reg[(op >> 3) & 7];
+            else {
+                const int alu = (op >> 3) & 7;
+                if ((alu == 2 || alu == 5) && r == 7)
+                    rd = 0; /* sub a / xor a */
+                else
+                    rd |= IDLE_A;
+                rd |= (alu == 1 || alu == 3) ? IDLE_CF : 0;
+                wr = IDLE_CF | IDLE_XF | (alu == 7 ? 0 : IDLE_A);
+            }
+        } else if ((op & 0xC7) == 0xC6) {
+            /* alu a,n */
+            const int alu = (op >> 3) & 7;
+            rd = IDLE_A | ((alu == 1 || alu == 3) ? IDLE_CF : 0);
+            wr = IDLE_CF | IDLE_XF | (alu == 7 ? 0 : IDLE_A);
+            pc++;
+        } else if ((op & 0xC7) == 0x06 && op != 0x36) {
+            /* ld r,n */
+            wr = idle_reg[(op >> 3) & 7];
+            pc++;
+        } else if ((op & 0xC6) == 0x04 && (op & 0x38) != 0x30) {
+            /* inc r / dec r, carry kept */
+            rd = idle_reg[(op >> 3) & 7];
+            wr = rd | IDLE_XF;
+        } else {
+            switch (op) {
+                case 0x00: /* nop */
+                    break;
+                case 0x07: /* rlca, rrca: S, Z and P/V kept */
+                case 0x0F:
+                    rd = IDLE_A | IDLE_XF;
+                    wr = IDLE_A | IDLE_CF | IDLE_XF;
+                    break;
+                case 0x17: /* rla, rra */
+                case 0x1F:
+                    rd = IDLE_A | IDLE_CF | IDLE_XF;
+                    wr = IDLE_A | IDLE_CF | IDLE_XF;
+                    break;
+                case 0x2F: /* cpl */
+                    rd = IDLE_A | IDLE_XF;
+                    wr = IDLE_A | IDLE_XF;
+                    break;
+                case 0x0A: /* ld a,(bc) */
+                    rd = IDLE_B | IDLE_C;
+                    wr = IDLE_A;
+                    address = R->BC.W;
+                    break;
+                case 0x1A: /* ld a,(de) */
+                    rd = IDLE_D | IDLE_E;
+                    wr = IDLE_A;
+                    address = R->DE.W;
+                    break;
+                case 0x3A: /* ld a,(nn) */
+                    wr = IDLE_A;
+                    address = Z80_RAM[pc & 0x1FFF] | Z80_RAM[(pc + 1) & 0x1FFF] << 8;
+                    pc += 2;
+                    break;
+                default:
+                    return 0;
+            }
+        }
+
+        if (address >= 0 && !idle_loop_source(address))
+            return 0;
+        reads |= rd & ~writes;
+        writes |= wr;
+    }
+    return pc == branch && !(reads & writes);
+}
+
+/* Called on every backward JR/JP. The first pass of a loop is analysed. If
+ * it polls, the next pass in the same slice, which read everything afresh,
+ * skips all the whole passes left. The loop is analysed again when it is
+ * entered with other pointers, the polled addresses depend on them. */
+void IdleZ80(register Z80 *R, register word Target, register word Branch) {
+    if (!z80_idle_skip || R->IRequest != INT_NONE)
+        return;
+
+    if (Target != idle.target || Branch != idle.branch ||
+        R->HL.W != idle.hl || R->BC.W != idle.bc || R->DE.W != idle.de ||
+        R->IX.W != idle.ix || R->IY.W != idle.iy) {
+        idle.target = Target;
+        idle.branch = Branch;
+        idle.hl = R->HL.W;
+        idle.bc = R->BC.W;
+        idle.de = R->DE.W;
+        idle.ix = R->IX.W;
+        idle.iy = R->IY.W;
+        idle.polls = idle_loop_detect(R, Target, Branch);
+    } else if (idle.polls) {
+        const int pass = idle.icount - R->ICount;
+
+        if (pass > 0 && pass <= IDLE_LOOP_MAX_CYCLES && R->ICount > pass) {
+            const int skipped = (R->ICount - 1) / pass * pass;
+
+            R->ICount -= skipped;
+            z80_idle_hits++;
+            z80_idle_cycles += skipped * Z80_FREQ_DIVISOR;
+        }
+    }
+    idle.icount = R->ICount;
+}
+
 byte RdZ80(register word Addr) {
 
   if (Addr < 0x4000)
@@ -326,10 +564,10 @@ void WrZ80(register word Addr, register byte Value) {
 }
 
 
-byte InZ80(register word Port) {return 0;}
-void OutZ80(register word Port, register byte Value) {;}
-void PatchZ80(register Z80 *R) {;}
-void DebugZ80(register Z80 *R) {;}
+byte InZ80(register word Port) {(void)Port; return 0;}
+void OutZ80(register word Port, register byte Value) {(void)Port; (void)Value;}
+void PatchZ80(register Z80 *R) {(void)R;}
+void DebugZ80(register Z80 *R) {(void)R;}
 
 void gwenesis_z80inst_save_state() {
 
@@ -27,6 +27,11 @@ void z80_execute(unsigned int target);
 void z80_run(int target);
 extern int zclk;
 
+/* Idle loop skipping: runtime switch, loops skipped and master cycles saved */
+extern int z80_idle_skip;
+extern unsigned int z80_idle_hits;
+extern unsigned int z80_idle_cycles;
+
 void gwenesis_z80inst_save_state();
 void gwenesis_z80inst_load_state();
 
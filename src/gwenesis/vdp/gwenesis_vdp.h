@@ -21,6 +21,8 @@ __license__ = "GPLv3"
 
 #pragma once
 
+#include <stdbool.h>
+
 #define BIT(v, idx) (((v) >> (idx)) & 1)
 #define BITS(v, idx, n) (((v) >> (idx)) & ((1 << (n)) - 1))
 
@@ -80,6 +82,22 @@ __license__ = "GPLv3"
 #define SAT_CACHE_MAX_SIZE 0x400 // SAT CACHE maximum size
 #define REG_SIZE 0x20            // REGISTERS total
 #define FIFO_SIZE 0x4            // FIFO maximum size
+#define TILE_CACHE_ROWS 0x400    // decoded pattern rows cache, power of 2
+
+// Renderer caches in SRAM, off by default (the RP2040 has little to spare),
+// enabled by the build options of the same name without the prefix
+#ifndef GWENESIS_VDP_TILE_CACHE
+#define GWENESIS_VDP_TILE_CACHE 0   // decoded pattern rows, 10KB
+#endif
+#ifndef GWENESIS_VDP_SPRITE_LISTS
+#define GWENESIS_VDP_SPRITE_LISTS 0 // sprites crossing each line, 5KB
+#endif
+#ifndef GWENESIS_VDP_EMPTY_ROWS
+#define GWENESIS_VDP_EMPTY_ROWS 0   // transparent pattern rows bitmap, 2KB
+#endif
+#ifndef GWENESIS_VDP_LINE_PALETTES
+#define GWENESIS_VDP_LINE_PALETTES 0 // per line CRAM records for the scanout, 3.5KB
+#endif
 
 #define COLOR_3B_TO_8B(c)  (((c) << 5) | ((c) << 2) | ((c) >> 1))
 #define CRAM_R(c)          COLOR_3B_TO_8B(BITS((c), 1, 3))
@@ -113,6 +131,90 @@ __license__ = "GPLv3"
 #define SHI_IS_SHADOW(x)     (!((x) & 0x80))
 #define SHI_IS_HIGHLIGHT(x)  ((x) & 0x40)
 
+#if GWENESIS_VDP_TILE_CACHE
+extern uint16_t gwenesis_vdp_tile_cache_tag[TILE_CACHE_ROWS];
+
+/* VRAM byte at address changed: drop the decoded pattern row cached in its slot */
+static inline void gwenesis_vdp_tile_cache_invalidate(unsigned int address) {
+    __atomic_store_n(&gwenesis_vdp_tile_cache_tag[(address >> 2) & (TILE_CACHE_ROWS - 1)], 0xFFFF, __ATOMIC_RELEASE);
+}
+#else
+static inline void gwenesis_vdp_tile_cache_invalidate(unsigned int address) {
+    (void) address;
+}
+#endif
+
+void gwenesis_vdp_tile_cache_reset();
+
+/* Nametable row run cached by a plane renderer, size bytes from address nt */
+typedef struct {
+    uint32_t nt;
+    uint32_t size;
+} gwenesis_vdp_strip_t;
+
+extern gwenesis_vdp_strip_t gwenesis_vdp_strips[2];
+
+/* VRAM byte at address changed: drop the plane strips read from its nametable row */
+static inline void gwenesis_vdp_strip_invalidate(unsigned int address) {
+    for (int plane = 0; plane < 2; plane++)
+        if (address - gwenesis_vdp_strips[plane].nt < gwenesis_vdp_strips[plane].size)
+            __atomic_store_n(&gwenesis_vdp_strips[plane].nt, 0xFFFFFFFF, __ATOMIC_RELEASE);
+}
+
+#if GWENESIS_VDP_EMPTY_ROWS
+/* One bit per pattern row (2048 patterns x 8 rows), set when the 4 bytes
+ * of the row are zero: a fully transparent row the planes skip without
+ * reading the row or its decoded copy. Written by the emulation core only. */
+extern uint32_t gwenesis_vdp_empty_rows[VRAM_MAX_SIZE / 4 / 32];
+
+/* VRAM byte at address changed, pixels is the new content of its row */
+static inline void gwenesis_vdp_empty_rows_update(unsigned int address, uint32_t pixels) {
+    const unsigned int row = address >> 2;
+    const uint32_t bit = 1u << (row & 31);
+
+    if (pixels)
+        gwenesis_vdp_empty_rows[row >> 5] &= ~bit;
+    else
+        gwenesis_vdp_empty_rows[row >> 5] |= bit;
+}
+
+static inline bool gwenesis_vdp_row_empty(unsigned int row) {
+    return (gwenesis_vdp_empty_rows[row >> 5] >> (row & 31)) & 1;
+}
+#else
+static inline void gwenesis_vdp_empty_rows_update(unsigned int address, uint32_t pixels) {
+    (void) address;
+    (void) pixels;
+}
+#endif
+
+extern bool gwenesis_vdp_sprites_dirty; // SAT cache written, per line sprite lists are rebuilt
+
+extern uint64_t gwenesis_vdp_cram_dirty; // one bit per CRAM entry changed since the last palette commit
+void gwenesis_vdp_palette_flush();
+
+/* Send the CRAM entries that changed to the display palette, once per line */
+static inline void gwenesis_vdp_palette_commit() {
+    if (gwenesis_vdp_cram_dirty)
+        gwenesis_vdp_palette_flush();
+}
+
+#if GWENESIS_VDP_LINE_PALETTES
+extern int gwenesis_vdp_line_palettes; // record CRAM changes per line for gwenesis_vdp_palette_row
+void gwenesis_vdp_palette_frame_begin(); // before the first line of a frame
+void gwenesis_vdp_palette_frame_end();   // after the last visible line
+void gwenesis_vdp_palette_row(int row);  // display: set the palette of the row about to be scanned out
+#else
+static inline void gwenesis_vdp_palette_frame_begin() {}
+static inline void gwenesis_vdp_palette_frame_end() {}
+#endif
+
+extern int gwenesis_vdp_skip_unchanged;               // do not draw frames identical to the last one
+extern bool gwenesis_vdp_frame_changed;               // a write changed the picture since the last frame start
+extern unsigned int gwenesis_vdp_frames_unchanged;    // frames not drawn because nothing changed
+bool gwenesis_vdp_frame_due(bool is_pal, int max_skip); // adaptive frameskip, the draw argument of gwenesis_vdp_frame_begin
+bool gwenesis_vdp_frame_begin(bool draw, bool complete);
+
 void gwenesis_vdp_reset();
 void gwenesis_vdp_set_hblank();
 void gwenesis_vdp_clear_hblank();
@@ -130,11 +232,17 @@ void gwenesis_vdp_write_memory_16(unsigned int address, unsigned int value);
 
 void gwenesis_vdp_set_buffers(unsigned char *screen_buffer, unsigned char *scaled_buffer);
 void gwenesis_vdp_set_buffer(uint8_t *ptr_screen_buffer);
+void gwenesis_vdp_set_buffer_lines(int lines);
 void gwenesis_vdp_get_buffer(uint16_t** ptr_screen_buffer);
 void gwenesis_vdp_render_line(int line);
 
 void gwenesis_vdp_render_config();
 
+void gwenesis_vdp_set_pipeline(bool enabled);
+bool gwenesis_vdp_get_pipeline();
+void gwenesis_vdp_pipeline_sync();
+int gwenesis_vdp_pipeline_render();
+
 unsigned int gwenesis_vdp_get_status();
 void gwenesis_vdp_get_debug_status(char *s);
 unsigned short gwenesis_vdp_get_cram(int index);
@@ -0,0 +1,193 @@
+/*
+Gwenesis : Genesis & megadrive Emulator.
+
+This program is free software: you can redistribute it and/or modify it under
+the terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+this program. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "bzhxx"
+__contact__ = "https://github.com/bzhxx"
+__license__ = "GPLv3"
+
+*/
+#ifndef _gwenesis_vdp_blit_H_
+#define _gwenesis_vdp_blit_H_
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gwenesis_vdp.h"
+
+/******************************************************************************
+ *
+ *  Pattern row blitters
+ *  A decoded pattern row is 8 pixels of one byte (0..15, 0 is transparent)
+ *  held in two 32-bit words, first pixel in the lowest byte. Each kernel
+ *  handles 4 pixels per word with mask arithmetic instead of testing and
+ *  storing every pixel: 0xFF bytes select the new pixel, 0x00 bytes keep
+ *  what is under it.
+ *  The destination is not word aligned (scrolling, sprite x), loads and
+ *  stores go through memcpy so Cortex-M0+ gets byte accesses and hosts get
+ *  plain unaligned words.
+ *
+ ******************************************************************************/
+
+#define BLIT_REP(b) ((uint32_t) (b) * 0x01010101u)
+
+static inline __attribute__((always_inline))
+uint32_t blit_load(const uint8_t* scr) {
+    uint32_t v;
+    memcpy(&v, scr, 4);
+    return v;
+}
+
+static inline __attribute__((always_inline))
+void blit_store(uint8_t* scr, uint32_t v) {
+    memcpy(scr, &v, 4);
+}
+
+/* 0xFF for every byte having bit 0 set */
+static inline __attribute__((always_inline))
+uint32_t blit_mask(uint32_t bits) {
+    return (bits & 0x01010101u) * 0xFF;
+}
+
+/* 0xFF for every non transparent pixel */
+static inline __attribute__((always_inline))
+uint32_t blit_opaque(uint32_t pix) {
+    return blit_mask((pix + 0x7F7F7F7Fu) >> 7);
+}
+
+/* Row words in drawing order, reversed for a horizontal flip */
+static inline __attribute__((always_inline))
+void blit_row(const uint32_t* row, bool fliph, uint32_t* p0, uint32_t* p1) {
+    if (fliph) {
+        *p0 = __builtin_bswap32(row[1]);
+        *p1 = __builtin_bswap32(row[0]);
+    }
+    else {
+        *p0 = row[0];
+        *p1 = row[1];
+    }
+}
+
+/* 8 pixels of one colour */
+static inline __attribute__((always_inline))
+void blit_fill(uint8_t* scr, uint8_t color) {
+    blit_store(scr, BLIT_REP(color));
+    blit_store(scr + 4, BLIT_REP(color));
+}
+
+/* Plane B: first layer, transparent pixels get the background colour */
+static inline __attribute__((always_inline))
+void blit_planeB(uint8_t* scr, const uint32_t* row, bool fliph, uint8_t attrs, uint8_t back) {
+    const uint32_t back4 = BLIT_REP(back);
+
+    if ((row[0] | row[1]) == 0) {
+        blit_fill(scr, back);
+        return;
+    }
+
+    uint32_t p0, p1;
+    blit_row(row, fliph, &p0, &p1);
+    const uint32_t attrs4 = BLIT_REP(attrs);
+    const uint32_t m0 = blit_opaque(p0), m1 = blit_opaque(p1);
+
+    if ((m0 & m1) == 0xFFFFFFFFu) {
+        blit_store(scr, p0 | attrs4);
+        blit_store(scr + 4, p1 | attrs4);
+        return;
+    }
+
+    blit_store(scr, ((p0 | attrs4) & m0) | (back4 & ~m0));
+    blit_store(scr + 4, ((p1 | attrs4) & m1) | (back4 & ~m1));
+}
+
+/* Plane A/window over plane B: low priority pixels do not cover high priority ones */
+static inline __attribute__((always_inline))
+void blit_planeA(uint8_t* scr, const uint32_t* row, bool fliph, uint8_t attrs) {
+    if ((row[0] | row[1]) == 0) return;
+
+    uint32_t p0, p1;
+    blit_row(row, fliph, &p0, &p1);
+    const uint32_t attrs4 = BLIT_REP(attrs);
+    uint32_t m0 = blit_opaque(p0), m1 = blit_opaque(p1);
+
+    if (attrs & PIXATTR_HIPRI) {
+        if ((m0 & m1) == 0xFFFFFFFFu) {
+            blit_store(scr, p0 | attrs4);
+            blit_store(scr + 4, p1 | attrs4);
+            return;
+        }
+    }
+
+    const uint32_t o0 = blit_load(scr), o1 = blit_load(scr + 4);
+
+    if (!(attrs & PIXATTR_HIPRI)) {
+        if ((m0 & m1) == 0xFFFFFFFFu && ((o0 | o1) & BLIT_REP(PIXATTR_HIPRI)) == 0) {
+            blit_store(scr, p0 | attrs4);
+            blit_store(scr + 4, p1 | attrs4);
+            return;
+        }
+        m0 &= ~blit_mask(o0 >> 7);
+        m1 &= ~blit_mask(o1 >> 7);
+    }
+
+    blit_store(scr, ((p0 | attrs4) & m0) | (o0 & ~m0));
+    blit_store(scr + 4, ((p1 | attrs4) & m1) | (o1 & ~m1));
+}
+
+/* Sprite into the sprite line buffer (shadow/highlight): the first sprite pixel wins */
+static inline __attribute__((always_inline))
+void blit_sprite(uint8_t* scr, const uint32_t* row, bool fliph, uint8_t attrs) {
+    if ((row[0] | row[1]) == 0) return;
+
+    uint32_t p0, p1;
+    blit_row(row, fliph, &p0, &p1);
+    const uint32_t attrs4 = BLIT_REP(attrs);
+    const uint32_t o0 = blit_load(scr), o1 = blit_load(scr + 4);
+
+    // not transparent pixel to write AND not already a sprite
+    const uint32_t m0 = blit_opaque(p0) & ~blit_mask(o0 >> 6);
+    const uint32_t m1 = blit_opaque(p1) & ~blit_mask(o1 >> 6);
+
+    blit_store(scr, ((p0 | attrs4) & m0) | (o0 & ~m0));
+    blit_store(scr + 4, ((p1 | attrs4) & m1) | (o1 & ~m1));
+}
+
+/* Sprite over the planes: never over a sprite, low priority ones not over high priority planes */
+static inline __attribute__((always_inline))
+void blit_sprite_over_planes(uint8_t* scr, const uint32_t* row, bool fliph, uint8_t attrs) {
+    if ((row[0] | row[1]) == 0) return;
+
+    uint32_t p0, p1;
+    blit_row(row, fliph, &p0, &p1);
+    const uint32_t attrs4 = BLIT_REP(attrs);
+    const uint32_t o0 = blit_load(scr), o1 = blit_load(scr + 4);
+
+    uint32_t m0, m1;
+    if (attrs & PIXATTR_HIPRI) {
+        // not already a sprite
+        m0 = blit_opaque(p0) & ~blit_mask(o0 >> 6);
+        m1 = blit_opaque(p1) & ~blit_mask(o1 >> 6);
+    }
+    else {
+        // not already a sprite or higher priority
+        m0 = blit_opaque(p0) & ~blit_mask(o0 >> 6 | o0 >> 7);
+        m1 = blit_opaque(p1) & ~blit_mask(o1 >> 6 | o1 >> 7);
+    }
+
+    blit_store(scr, ((p0 | attrs4) & m0) | (o0 & ~m0));
+    blit_store(scr + 4, ((p1 | attrs4) & m1) | (o1 & ~m1));
+}
+
+#endif
@@ -23,6 +23,7 @@ __license__ = "GPLv3"
 
 #include "../cpus/M68K/m68k.h"
 #include "gwenesis_vdp.h"
+#include "gwenesis_vdp_blit.h"
 #include "../io/gwenesis_io.h"
 #include "../bus/gwenesis_bus.h"
 #include "../savestate/gwenesis_savestate.h"
@@ -39,11 +40,43 @@ extern unsigned char gwenesis_vdp_regs[]; // Registers
 
 extern unsigned short VSRAM[]; // VSRAM - Scrolling
 
+// The line renderer reads the registers, VSRAM and horizontal scroll through
+// these: they point at the live VDP state, or at a captured line state when
+// rendering is deferred to the other core (see line pipeline below).
+static unsigned char* const vdp_live_regs = gwenesis_vdp_regs;
+static const unsigned char* render_regs = gwenesis_vdp_regs;
+static const unsigned short* render_vsram = VSRAM;
+static unsigned short render_hscroll[2]; // plane A, plane B
+static int render_width;                 // screen_width of the frame the line belongs to
+
+// Register fields as the renderer sees them, always from render_regs. The
+// REGn_ macros of gwenesis_vdp.h read the live registers and are not used
+// by the renderer.
+#define RREG0_DISABLE_DISPLAY (render_regs[0] & 1)
+#define RREG1_PAL             BIT(render_regs[1], 3)
+#define RREG1_DISP_ENABLED    BIT(render_regs[1], 6)
+#define RREG2_NAMETABLE_A     (BITS(render_regs[2], 3, 3) << 13)
+#define RREG3_NAMETABLE_W     BITS(render_regs[3], 1, 5)
+#define RREG4_NAMETABLE_B     (BITS(render_regs[4], 0, 3) << 13)
+#define RREG5_SAT_ADDRESS     ((render_regs[5] & ((render_regs[12] & 0x01) ? 0x7E : 0x7F)) << 9)
+#define RREG7_BACKDROP        render_regs[7]
+#define RREG11_VSCROLL_MODE   ((render_regs[11] & 4) >> 2)
+#define RREG12_MODE_H40       (render_regs[12] & 1)
+#define RREG12_INTERLACE      BITS(render_regs[12], 1, 2)
+#define RREG12_MODE_SHI       BITS(render_regs[12], 3, 1)
+#define RREG16_HSCROLL_SIZE   BITS(render_regs[16], 0, 2)
+#define RREG16_VSCROLL_SIZE   BITS(render_regs[16], 4, 2)
+#define RREG17_WINDOW_HPOS    BITS(render_regs[17], 0, 5)
+#define RREG17_WINDOW_RIGHT   BIT(render_regs[17], 7)
+#define RREG18_WINDOW_VPOS    BITS(render_regs[18], 0, 5)
+#define RREG18_WINDOW_DOWN    (render_regs[18] & 0x80)
+
 // Define screen buffers: original and scaled for host RGB
 //unsigned char *screen, *scaled_screen;
 
 // Define SCREEN buffers for embedded 565 format
 static uint8_t* screen_buffer_line = 0;
+static unsigned int screen_buffer_mask = ~0u; // line ring: rows - 1
 
 //static unsigned short *screen_buffer=0;
 
@@ -119,6 +152,11 @@ void gwenesis_vdp_set_buffer(uint8_t* ptr_screen_buffer) {
     //screen_buffer = ptr_screen_buffer;
 }
 
+/* Buffer holds only `lines` rows (power of 2), line y is drawn in row y % lines. 0: whole frame */
+void gwenesis_vdp_set_buffer_lines(int lines) {
+    screen_buffer_mask = lines ? (unsigned int) lines - 1 : ~0u;
+}
+
 void gwenesis_vdp_get_buffer(uint16_t** ptr_screen_buffer) {
     *ptr_screen_buffer = (uint16_t *)&render_buffer[PIX_OVERFLOW];
     //screen_buffer = ptr_screen_buffer;
@@ -126,13 +164,12 @@ void gwenesis_vdp_get_buffer(uint16_t** ptr_screen_buffer) {
 
 /******************************************************************************
  *
- *  Draw  Sprite character /8pixels in row
- *  without checking overdraw for pixels collision detection
- *  with Horizontal flip variation
- *  for Shadow/highlight :
- *    draw in fresh line buffer using draw_pattern_xxfliph_sprite(..)
- *  otherwise:
- *   draw over dirty planes using draw_pattern_xxfliph_sprite_over_planes(..)
+ *  Decoded pattern row cache
+ *  A pattern row (4 bytes of VRAM) unpacked to one byte per pixel, direct
+ *  mapped on its row address (VRAM address >> 2). VRAM writes drop the slot
+ *  of the row they touch (gwenesis_vdp_tile_cache_invalidate), so rows that
+ *  do not change are unpacked once instead of on every scanline.
+ *  Without GWENESIS_VDP_TILE_CACHE, rows are unpacked on every use.
  *
  ******************************************************************************/
 
@@ -145,346 +182,152 @@ void gwenesis_vdp_get_buffer(uint16_t** ptr_screen_buffer) {
 #define PIX6(P) ( ((P) & 0xF0000000 ) >>  28 )
 #define PIX7(P) ( ((P) & 0x0F000000 ) >>  24 )
 
-static inline __attribute__((always_inline))
-void draw_pattern_nofliph_sprite(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    /*  not transparent pixel to write AND not already a sprite*/
-    if (PIX0(p) && (scr[0] & PIXATTR_SPRITE) == 0) scr[0] = attrs | PIX0(p);
-    if (PIX1(p) && (scr[1] & PIXATTR_SPRITE) == 0) scr[1] = attrs | PIX1(p);
-    if (PIX2(p) && (scr[2] & PIXATTR_SPRITE) == 0) scr[2] = attrs | PIX2(p);
-    if (PIX3(p) && (scr[3] & PIXATTR_SPRITE) == 0) scr[3] = attrs | PIX3(p);
-    if (PIX4(p) && (scr[4] & PIXATTR_SPRITE) == 0) scr[4] = attrs | PIX4(p);
-    if (PIX5(p) && (scr[5] & PIXATTR_SPRITE) == 0) scr[5] = attrs | PIX5(p);
-    if (PIX6(p) && (scr[6] & PIXATTR_SPRITE) == 0) scr[6] = attrs | PIX6(p);
-    if (PIX7(p) && (scr[7] & PIXATTR_SPRITE) == 0) scr[7] = attrs | PIX7(p);
-}
+#if GWENESIS_VDP_TILE_CACHE
+uint16_t gwenesis_vdp_tile_cache_tag[TILE_CACHE_ROWS];
+static uint32_t tile_cache[TILE_CACHE_ROWS][2];
+#else
+static uint32_t tile_row[2]; // the row being drawn
+#endif
 
+#if GWENESIS_VDP_EMPTY_ROWS
+uint32_t gwenesis_vdp_empty_rows[VRAM_MAX_SIZE / 4 / 32];
+#else
+/* Without the bitmap, a row is tested in VRAM */
 static inline __attribute__((always_inline))
-void draw_pattern_fliph_sprite(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    /*  not transparent pixel to write AND not already a sprite*/
-    if (PIX7(p) && (scr[0] & PIXATTR_SPRITE) == 0) scr[0] = attrs | PIX7(p);
-    if (PIX6(p) && (scr[1] & PIXATTR_SPRITE) == 0) scr[1] = attrs | PIX6(p);
-    if (PIX5(p) && (scr[2] & PIXATTR_SPRITE) == 0) scr[2] = attrs | PIX5(p);
-    if (PIX4(p) && (scr[3] & PIXATTR_SPRITE) == 0) scr[3] = attrs | PIX4(p);
-    if (PIX3(p) && (scr[4] & PIXATTR_SPRITE) == 0) scr[4] = attrs | PIX3(p);
-    if (PIX2(p) && (scr[5] & PIXATTR_SPRITE) == 0) scr[5] = attrs | PIX2(p);
-    if (PIX1(p) && (scr[6] & PIXATTR_SPRITE) == 0) scr[6] = attrs | PIX1(p);
-    if (PIX0(p) && (scr[7] & PIXATTR_SPRITE) == 0) scr[7] = attrs | PIX0(p);
+bool gwenesis_vdp_row_empty(unsigned int row) {
+    return *(uint32_t *)(VRAM + (row << 2)) == 0;
 }
+#endif
 
-static inline __attribute__((always_inline))
-void draw_pattern_nofliph_sprite_over_planes(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    /* High priority */
-    if (attrs & PIXATTR_HIPRI) {
-        /*  not transparent pixel to write AND not already a sprite*/
-        if (PIX0(p) && (scr[0] & PIXATTR_SPRITE) == 0) scr[0] = attrs | PIX0(p);
-        if (PIX1(p) && (scr[1] & PIXATTR_SPRITE) == 0) scr[1] = attrs | PIX1(p);
-        if (PIX2(p) && (scr[2] & PIXATTR_SPRITE) == 0) scr[2] = attrs | PIX2(p);
-        if (PIX3(p) && (scr[3] & PIXATTR_SPRITE) == 0) scr[3] = attrs | PIX3(p);
-        if (PIX4(p) && (scr[4] & PIXATTR_SPRITE) == 0) scr[4] = attrs | PIX4(p);
-        if (PIX5(p) && (scr[5] & PIXATTR_SPRITE) == 0) scr[5] = attrs | PIX5(p);
-        if (PIX6(p) && (scr[6] & PIXATTR_SPRITE) == 0) scr[6] = attrs | PIX6(p);
-        if (PIX7(p) && (scr[7] & PIXATTR_SPRITE) == 0) scr[7] = attrs | PIX7(p);
-    }
-    /* Low priority */
-    else {
-        /*  not transparent pixel to write AND not already a sprite or higher priority*/
-        if (PIX0(p) && (scr[0] & PIXATTR_SPRITE_HIPRI) == 0) scr[0] = attrs | PIX0(p);
-        if (PIX1(p) && (scr[1] & PIXATTR_SPRITE_HIPRI) == 0) scr[1] = attrs | PIX1(p);
-        if (PIX2(p) && (scr[2] & PIXATTR_SPRITE_HIPRI) == 0) scr[2] = attrs | PIX2(p);
-        if (PIX3(p) && (scr[3] & PIXATTR_SPRITE_HIPRI) == 0) scr[3] = attrs | PIX3(p);
-        if (PIX4(p) && (scr[4] & PIXATTR_SPRITE_HIPRI) == 0) scr[4] = attrs | PIX4(p);
-        if (PIX5(p) && (scr[5] & PIXATTR_SPRITE_HIPRI) == 0) scr[5] = attrs | PIX5(p);
-        if (PIX6(p) && (scr[6] & PIXATTR_SPRITE_HIPRI) == 0) scr[6] = attrs | PIX6(p);
-        if (PIX7(p) && (scr[7] & PIXATTR_SPRITE_HIPRI) == 0) scr[7] = attrs | PIX7(p);
-    }
+void gwenesis_vdp_tile_cache_reset() {
+#if GWENESIS_VDP_TILE_CACHE
+    memset(gwenesis_vdp_tile_cache_tag, 0xFF, sizeof(gwenesis_vdp_tile_cache_tag));
+#endif
+    for (int plane = 0; plane < 2; plane++)
+        gwenesis_vdp_strips[plane] = (gwenesis_vdp_strip_t) { 0xFFFFFFFF, 0 };
 }
 
 static inline __attribute__((always_inline))
-void draw_pattern_fliph_sprite_over_planes(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    /* High priority */
-    if (attrs & PIXATTR_HIPRI) {
-        /*  not transparent pixel to write AND not already a sprite*/
-        if (PIX7(p) && (scr[0] & PIXATTR_SPRITE) == 0) scr[0] = attrs | PIX7(p);
-        if (PIX6(p) && (scr[1] & PIXATTR_SPRITE) == 0) scr[1] = attrs | PIX6(p);
-        if (PIX5(p) && (scr[2] & PIXATTR_SPRITE) == 0) scr[2] = attrs | PIX5(p);
-        if (PIX4(p) && (scr[3] & PIXATTR_SPRITE) == 0) scr[3] = attrs | PIX4(p);
-        if (PIX3(p) && (scr[4] & PIXATTR_SPRITE) == 0) scr[4] = attrs | PIX3(p);
-        if (PIX2(p) && (scr[5] & PIXATTR_SPRITE) == 0) scr[5] = attrs | PIX2(p);
-        if (PIX1(p) && (scr[6] & PIXATTR_SPRITE) == 0) scr[6] = attrs | PIX1(p);
-        if (PIX0(p) && (scr[7] & PIXATTR_SPRITE) == 0) scr[7] = attrs | PIX0(p);
-    }
-    /* Low priority */
-    else {
-        /*  not transparent pixel to write AND not already a sprite or higher priority*/
-        if (PIX7(p) && (scr[0] & PIXATTR_SPRITE_HIPRI) == 0) scr[0] = attrs | PIX7(p);
-        if (PIX6(p) && (scr[1] & PIXATTR_SPRITE_HIPRI) == 0) scr[1] = attrs | PIX6(p);
-        if (PIX5(p) && (scr[2] & PIXATTR_SPRITE_HIPRI) == 0) scr[2] = attrs | PIX5(p);
-        if (PIX4(p) && (scr[3] & PIXATTR_SPRITE_HIPRI) == 0) scr[3] = attrs | PIX4(p);
-        if (PIX3(p) && (scr[4] & PIXATTR_SPRITE_HIPRI) == 0) scr[4] = attrs | PIX3(p);
-        if (PIX2(p) && (scr[5] & PIXATTR_SPRITE_HIPRI) == 0) scr[5] = attrs | PIX2(p);
-        if (PIX1(p) && (scr[6] & PIXATTR_SPRITE_HIPRI) == 0) scr[6] = attrs | PIX1(p);
-        if (PIX0(p) && (scr[7] & PIXATTR_SPRITE_HIPRI) == 0) scr[7] = attrs | PIX0(p);
-    }
-}
-
-/******************************************************************************
- *
- *  Draw  characters/8pixels in row
- *  without checking overdraw for pixels collision detection
- *  with Horizontal flip variation for plane A & B
- *
- ******************************************************************************/
-
-
-static inline __attribute__((always_inline)) void
-draw_pattern_nofliph_planeB(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    const uint8_t back = gwenesis_vdp_regs[7];
-
-    if (p == 0) {
-        scr[0] = back;
-        scr[1] = back;
-        scr[2] = back;
-        scr[3] = back;
-        scr[4] = back;
-        scr[5] = back;
-        scr[6] = back;
-        scr[7] = back;
-
-        return;
-    }
-
-    scr[0] = PIX0(p) ? attrs | (PIX0(p)) : back;
-    scr[1] = PIX1(p) ? attrs | (PIX1(p)) : back;
-    scr[2] = PIX2(p) ? attrs | (PIX2(p)) : back;
-    scr[3] = PIX3(p) ? attrs | (PIX3(p)) : back;
-    scr[4] = PIX4(p) ? attrs | (PIX4(p)) : back;
-    scr[5] = PIX5(p) ? attrs | (PIX5(p)) : back;
-    scr[6] = PIX6(p) ? attrs | (PIX6(p)) : back;
-    scr[7] = PIX7(p) ? attrs | (PIX7(p)) : back;
+void decode_tile_row(uint32_t* pix, unsigned int row) {
+    const uint32_t p = *(uint32_t *)(VRAM + (row << 2));
+    pix[0] = PIX0(p) | PIX1(p) << 8 | PIX2(p) << 16 | PIX3(p) << 24;
+    pix[1] = PIX4(p) | PIX5(p) << 8 | PIX6(p) << 16 | PIX7(p) << 24;
 }
 
-static inline __attribute__((always_inline)) void
-draw_pattern_fliph_planeB(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    const uint8_t back = gwenesis_vdp_regs[7];
-    if (p == 0) {
-        scr[0] = back;
-        scr[1] = back;
-        scr[2] = back;
-        scr[3] = back;
-        scr[4] = back;
-        scr[5] = back;
-        scr[6] = back;
-        scr[7] = back;
-
-        return;
+static inline __attribute__((always_inline))
+const uint32_t* get_tile_row(unsigned int row) {
+#if GWENESIS_VDP_TILE_CACHE
+    const unsigned int slot = row & (TILE_CACHE_ROWS - 1);
+    uint32_t* pix = tile_cache[slot];
+
+    if (gwenesis_vdp_tile_cache_tag[slot] != row) {
+        // tag first: a VRAM write from the emulation core after this point invalidates again
+        gwenesis_vdp_tile_cache_tag[slot] = row;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        decode_tile_row(pix, row);
     }
-
-    scr[0] = PIX7(p) ? attrs | (PIX7(p)) : back;
-    scr[1] = PIX6(p) ? attrs | (PIX6(p)) : back;
-    scr[2] = PIX5(p) ? attrs | (PIX5(p)) : back;
-    scr[3] = PIX4(p) ? attrs | (PIX4(p)) : back;
-    scr[4] = PIX3(p) ? attrs | (PIX3(p)) : back;
-    scr[5] = PIX2(p) ? attrs | (PIX2(p)) : back;
-    scr[6] = PIX1(p) ? attrs | (PIX1(p)) : back;
-    scr[7] = PIX0(p) ? attrs | (PIX0(p)) : back;
+    return pix;
+#else
+    decode_tile_row(tile_row, row);
+    return tile_row;
+#endif
 }
 
-static inline __attribute__((always_inline)) void
-draw_pattern_nofliph_planeAoverB(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    if (attrs & PIXATTR_HIPRI) {
-        if (PIX0(p)) scr[0] = attrs | (PIX0(p));
-        if (PIX1(p)) scr[1] = attrs | (PIX1(p));
-        if (PIX2(p)) scr[2] = attrs | (PIX2(p));
-        if (PIX3(p)) scr[3] = attrs | (PIX3(p));
-        if (PIX4(p)) scr[4] = attrs | (PIX4(p));
-        if (PIX5(p)) scr[5] = attrs | (PIX5(p));
-        if (PIX6(p)) scr[6] = attrs | (PIX6(p));
-        if (PIX7(p)) scr[7] = attrs | (PIX7(p));
-    }
-    else {
-        if (PIX0(p) && (scr[0] & PIXATTR_HIPRI) == 0) scr[0] = attrs | PIX0(p);
-        if (PIX1(p) && (scr[1] & PIXATTR_HIPRI) == 0) scr[1] = attrs | PIX1(p);
-        if (PIX2(p) && (scr[2] & PIXATTR_HIPRI) == 0) scr[2] = attrs | PIX2(p);
-        if (PIX3(p) && (scr[3] & PIXATTR_HIPRI) == 0) scr[3] = attrs | PIX3(p);
-        if (PIX4(p) && (scr[4] & PIXATTR_HIPRI) == 0) scr[4] = attrs | PIX4(p);
-        if (PIX5(p) && (scr[5] & PIXATTR_HIPRI) == 0) scr[5] = attrs | PIX5(p);
-        if (PIX6(p) && (scr[6] & PIXATTR_HIPRI) == 0) scr[6] = attrs | PIX6(p);
-        if (PIX7(p) && (scr[7] & PIXATTR_HIPRI) == 0) scr[7] = attrs | PIX7(p);
-    }
-}
-
-static inline __attribute__((always_inline)) void
-draw_pattern_fliph_planeAoverB(uint8_t* scr, uint32_t p, uint8_t attrs) {
-    if (p == 0) return;
-
-    if (attrs & PIXATTR_HIPRI) {
-        if (PIX7(p)) scr[0] = attrs | PIX7(p);
-        if (PIX6(p)) scr[1] = attrs | PIX6(p);
-        if (PIX5(p)) scr[2] = attrs | PIX5(p);
-        if (PIX4(p)) scr[3] = attrs | PIX4(p);
-        if (PIX3(p)) scr[4] = attrs | PIX3(p);
-        if (PIX2(p)) scr[5] = attrs | PIX2(p);
-        if (PIX1(p)) scr[6] = attrs | PIX1(p);
-        if (PIX0(p)) scr[7] = attrs | PIX0(p);
-    }
-    else {
-        if (PIX7(p) && (scr[0] & PIXATTR_HIPRI) == 0) scr[0] = attrs | PIX7(p);
-        if (PIX6(p) && (scr[1] & PIXATTR_HIPRI) == 0) scr[1] = attrs | PIX6(p);
-        if (PIX5(p) && (scr[2] & PIXATTR_HIPRI) == 0) scr[2] = attrs | PIX5(p);
-        if (PIX4(p) && (scr[3] & PIXATTR_HIPRI) == 0) scr[3] = attrs | PIX4(p);
-        if (PIX3(p) && (scr[4] & PIXATTR_HIPRI) == 0) scr[4] = attrs | PIX3(p);
-        if (PIX2(p) && (scr[5] & PIXATTR_HIPRI) == 0) scr[5] = attrs | PIX2(p);
-        if (PIX1(p) && (scr[6] & PIXATTR_HIPRI) == 0) scr[6] = attrs | PIX1(p);
-        if (PIX0(p) && (scr[7] & PIXATTR_HIPRI) == 0) scr[7] = attrs | PIX0(p);
-    }
-}
+/* Row paty of the pattern, vertical flip applied */
+#define PATTERN_ROW_INDEX(name, paty) ((((name) & 0x07FF) << 3) + (((name) & 0x1000) ? 7 - (paty) : (paty)))
+#define PATTERN_ROW(name, paty) get_tile_row(PATTERN_ROW_INDEX(name, paty))
 
 /******************************************************************************
  *
  *  Draw  characters/8pixels in row
  *  with/without checking overdraw for pixels collision detection
- *  used for sprites and planes drawing
+ *  used for sprites and planes drawing (see gwenesis_vdp_blit.h)
+ *  for Shadow/highlight :
+ *    sprites are drawn in fresh line buffer using draw_pattern_sprite(..)
+ *  otherwise:
+ *    over dirty planes using draw_pattern_sprite_over_planes(..)
  *
  ******************************************************************************/
 static inline __attribute__((always_inline))
 void draw_pattern_sprite(uint8_t* scr, uint16_t name, int paty) {
-    // uint16_t pat_addr = name << 5; //name * 32;
-    // uint8_t pat_palette = BITS(name, 13, 2);
-    // //unsigned int is_pat_pri = name & 0x8000;
-    // uint8_t *pattern = VRAM + pat_addr;
-    // uint8_t attrs = (pat_palette << 4) | ((name & 0x8000) ? PIXATTR_SPRITE_HIPRI : PIXATTR_SPRITE);
     const uint8_t attrs = ((name & 0x6000) >> 9) + ((name & 0x8000) >> 8) + PIXATTR_SPRITE;
 
-    unsigned int pattern;
-
-    // Vertical flip ?
-    // if (name & 0x1000)
-    //   pattern += (7 - paty) * 4;
-    // else
-    //   pattern += paty * 4;
-
-    // unsigned int  pattern;
-
-    // Vertical flip ?
-    if (name & 0x1000)
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul((7 - paty), 4)); //) pat_addr;
-    else
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul(paty, 4));
-
-    // Horizontal flip ?
-    if (name & 0x0800)
-        draw_pattern_fliph_sprite(scr, pattern, attrs);
-    else
-        draw_pattern_nofliph_sprite(scr, pattern, attrs);
+    blit_sprite(scr, PATTERN_ROW(name, paty), name & 0x0800, attrs);
 }
 
 static inline __attribute__((always_inline))
 void draw_pattern_sprite_over_planes(uint8_t* scr, uint16_t name, int paty) {
-    // uint16_t pat_addr = name << 5 ; //* 32;
-    // int pat_palette = BITS(name, 13, 2);
-    // int is_pat_pri = name & 0x8000;
-    // uint8_t *pattern = VRAM + pat_addr;
-    // uint8_t attrs = (pat_palette << 4) | (is_pat_pri ? PIXATTR_SPRITE_HIPRI : PIXATTR_SPRITE);
-
-    // Vertical flip ?
-    // if (name & 0x1000)
-    //   pattern += (7 - paty) * 4;
-    // else
-    //   pattern += paty * 4;
-
-    //uint8_t attrs = ( (name & 0x6000 ) >> 9 ) | ((name & 0x8000) ? PIXATTR_SPRITE_HIPRI : PIXATTR_SPRITE);
     const uint8_t attrs = ((name & 0x6000) >> 9) + ((name & 0x8000) >> 8) + PIXATTR_SPRITE;
-    //uint8_t attrs = ( (name >>9) & 0x70 ) | PIXATTR_SPRITE;
-
-    unsigned int pattern;
-
-    // Vertical flip ?
-    if (name & 0x1000)
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul((7 - paty), 4)); //) pat_addr;
-    else
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul(paty, 4));
 
-    // Horizontal flip ?
-    if (name & 0x0800)
-        draw_pattern_fliph_sprite_over_planes(scr, pattern, attrs);
-    else
-        draw_pattern_nofliph_sprite_over_planes(scr, pattern, attrs);
+    blit_sprite_over_planes(scr, PATTERN_ROW(name, paty), name & 0x0800, attrs);
 }
 
 static inline __attribute__((always_inline))
 void draw_pattern_planeB(uint8_t* scr, uint16_t name, int paty) {
-    // uint16_t pat_addr = name  << 5; // * 32;
-    // uint8_t pat_palette = BITS(name, 13, 2);
-    // unsigned int is_pat_pri = name & 0x8000;
-    //uint8_t *pattern = VRAM + pat_addr;
-
-    const uint8_t attrs = ((name & 0x6000) >> 9) + ((name & 0x8000) >> 8);
+    const unsigned int row = PATTERN_ROW_INDEX(name, paty);
 
-    unsigned int pattern;
-
-    // Vertical flip ?
-    if (name & 0x1000)
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul((7 - paty), 4)); //) pat_addr;
-    else
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul(paty, 4));
-
-    //  if ((*(unsigned int *)pattern) == 0 ) return;
-    // uint8_t *pattern = VRAM + ((name << 5) & 0xFFFF); //) pat_addr;
-    //uint32_t pattern = VRAM[(name & 0x07FF) << 5]; //) pat_addr;
+    if (gwenesis_vdp_row_empty(row)) {
+        blit_fill(scr, RREG7_BACKDROP);
+        return;
+    }
 
-    // Horizontal flip ?
-    if (name & 0x0800)
-        draw_pattern_fliph_planeB(scr, pattern, attrs);
+    const uint8_t attrs = ((name & 0x6000) >> 9) + ((name & 0x8000) >> 8);
 
-    else
-        draw_pattern_nofliph_planeB(scr, pattern, attrs);
+    blit_planeB(scr, get_tile_row(row), name & 0x0800, attrs, RREG7_BACKDROP);
 }
 
 static inline __attribute__((always_inline))
 void draw_pattern_planeA(uint8_t* scr, uint16_t name, int paty) {
-    // uint16_t pat_addr = name << 5; //* 32;
-    // uint8_t pat_palette = BITS(name, 13, 2);
-    // unsigned int is_pat_pri = name & 0x8000;
-    // uint8_t *pattern = VRAM + pat_addr;
+    const unsigned int row = PATTERN_ROW_INDEX(name, paty);
+
+    if (gwenesis_vdp_row_empty(row)) return;
 
     const uint8_t attrs = ((name & 0x6000) >> 9) + ((name & 0x8000) >> 8);
 
+    blit_planeA(scr, get_tile_row(row), name & 0x0800, attrs);
+}
 
-    unsigned int pattern;
+static uint16_t ntwidth_x2;
+static uint16_t ntw_mask, nth_mask;
 
-    // Vertical flip ?
-    // if (name & 0x1000)
-    //   pattern += (7 - paty) * 4;
-    // else
-    //   pattern += paty * 4;
+/******************************************************************************
+ *
+ *  Nametable strip cache
+ *  Without column scrolling, the 8 lines of a tile row draw the same run of
+ *  nametable entries. Each plane keeps the last run it read, tagged by its
+ *  nametable row address (gwenesis_vdp_strips, shared with the VRAM write
+ *  path) and by first column, cell count and width mask. Only the pattern
+ *  row changes from one line to the next. A VRAM write into the cached
+ *  nametable row drops the strip (gwenesis_vdp_strip_invalidate).
+ *
+ ******************************************************************************/
 
-    // Vertical flip ?
-    if (name & 0x1000)
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul((7 - paty), 4)); //) pat_addr;
-    else
-        pattern = *(unsigned int *)(VRAM + ((name & 0x07FF) << 5) + __fast_mul(paty, 4));
+#define STRIP_CELLS 42
 
-    // Horizontal flip ?
-    if (name & 0x0800)
-        draw_pattern_fliph_planeAoverB(scr, pattern, attrs);
+gwenesis_vdp_strip_t gwenesis_vdp_strips[2]; // plane A, plane B
+static uint32_t strip_key[2];
+static uint16_t strip_names[2][STRIP_CELLS];
 
-    else
-        draw_pattern_nofliph_planeAoverB(scr, pattern, attrs);
+static inline __attribute__((always_inline))
+const uint16_t* get_strip(int plane, unsigned int nt, uint8_t col, unsigned int cells) {
+    const uint32_t key = col | cells << 8 | ntw_mask << 16;
+    uint16_t* names = strip_names[plane];
+
+    if (gwenesis_vdp_strips[plane].nt != nt || strip_key[plane] != key) {
+        // tag first: a VRAM write from the emulation core after this point invalidates again
+        gwenesis_vdp_strips[plane].size = ntwidth_x2;
+        gwenesis_vdp_strips[plane].nt = nt;
+        strip_key[plane] = key;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        for (unsigned int i = 0; i < cells; i++) {
+            names[i] = FETCH16VRAM(nt + __fast_mul(col , 2));
+            col = (col + 1) & ntw_mask;
+        }
+    }
+    return names;
 }
 
-static uint16_t ntwidth_x2;
-static uint16_t ntw_mask, nth_mask;
-
 /******************************************************************************
  *
  *  Return the Horizontal scrolling
@@ -492,16 +335,17 @@ static uint16_t ntw_mask, nth_mask;
  ******************************************************************************/
 
 static inline __attribute__((always_inline))
-unsigned int get_hscroll_vram(int line) {
-    switch (REG11_HSCROLL_MODE) {
+unsigned int get_hscroll_vram(const unsigned char* regs, int line) {
+    const unsigned int hscroll_address = regs[13] << 10;
+    switch (regs[11] & 3) {
         case 0: // Full screen scrolling
-            return REG13_HSCROLL_ADDRESS;
+            return hscroll_address;
         case 1: // First 8 lines
-            return REG13_HSCROLL_ADDRESS + (line & 7) * 4;
+            return hscroll_address + (line & 7) * 4;
         case 2: // Every row
-            return REG13_HSCROLL_ADDRESS + (line & ~7) * 4;
-        case 3: // Every line
-            return REG13_HSCROLL_ADDRESS + line * 4;
+            return hscroll_address + (line & ~7) * 4;
+        default: // Every line
+            return hscroll_address + line * 4;
     }
 }
 
@@ -512,16 +356,13 @@ unsigned int get_hscroll_vram(int line) {
  ******************************************************************************/
 //__attribute__((optimize("unroll-loops")))
 static inline __attribute__((always_inline))
-void draw_line_b(int line) {
+void draw_line_b(int line, const int width, const bool column_scrolling) {
     uint8_t* scr = &render_buffer[PIX_OVERFLOW];
 
-    const unsigned int ntaddr = REG4_NAMETABLE_B;
-    uint16_t scrollx = FETCH16VRAM(get_hscroll_vram(line) + 2) & 0x3FF;
-    const uint16_t* vsram = &VSRAM[1];
-    const uint8_t* end = scr + screen_width;
-
-    //bool column_scrolling = BIT(gwenesis_vdp_regs[11], 2);
-    const bool column_scrolling = gwenesis_vdp_regs[11] & 0x4;
+    const unsigned int ntaddr = RREG4_NAMETABLE_B;
+    uint16_t scrollx = render_hscroll[1] & 0x3FF;
+    const uint16_t* vsram = &render_vsram[1];
+    const uint8_t* end = scr + width;
 
     // Invert horizontal scrolling (because it goes right, but we need to offset
     // of the first screen pixel)
@@ -529,8 +370,20 @@ void draw_line_b(int line) {
     uint8_t col = (scrollx >> 3) & ntw_mask;
     const uint8_t patx = scrollx & 7;
 
-    unsigned int numcell = 0;
     scr -= patx;
+    if (!column_scrolling) {
+        const uint16_t scrolly = *vsram + line;
+        const uint8_t row = (scrolly >> 3) & nth_mask;
+        const uint8_t paty = scrolly & 7;
+        const unsigned int cells = (width + patx + 7) >> 3;
+        const uint16_t* names = get_strip(1, ntaddr + row * ntwidth_x2, col, cells);
+
+        for (unsigned int i = 0; i < cells; i++, scr += 8)
+            draw_pattern_planeB(scr, names[i], paty);
+        return;
+    }
+
+    unsigned int numcell = 0;
     while (scr < end) {
         // Calculate vertical scrolling for the current line
         uint16_t scrolly = *vsram + line;
@@ -551,6 +404,29 @@ void draw_line_b(int line) {
     }
 }
 
+/******************************************************************************
+ *
+ *  Render Window on screen line
+ *  Kept out of the plane variants: its fully unrolled loop is the largest
+ *  part of the plane drawing and does not depend on the scrolling mode.
+ *
+ ******************************************************************************/
+static __noinline void draw_window(uint8_t* pos, int line, int Window_first, int Window_last, int wdwidth_x2) {
+    int row = line >> 3;
+    int paty = line & 7;
+    //int wdwidth = (screen_width == 320 ? 64 : 32);
+    //unsigned int nt = base_w + row * 2 * wdwidth + Window_first / 4;
+
+    unsigned int nt = base_w + row * wdwidth_x2 + Window_first / 4;
+
+    #pragma GCC unroll(64)
+    for (int i = Window_first / 8; i < Window_last / 8; ++i) {
+        draw_pattern_planeA(pos, FETCH16VRAM(nt), paty);
+        nt += 2;
+        pos += 8;
+    }
+}
+
 /******************************************************************************
  *
  *  Render PLANE A and Window on screen line
@@ -558,18 +434,18 @@ void draw_line_b(int line) {
  ******************************************************************************/
 //_attribute__((optimize("unroll-loops")))
 static inline __attribute__((always_inline))
-void draw_line_aw(int line) {
+void draw_line_aw(int line, const int width, const bool column_scrolling) {
     uint8_t* scr = &render_buffer[PIX_OVERFLOW];
 
-    unsigned int ntaddr = REG2_NAMETABLE_A;
-    uint16_t scrollx = FETCH16VRAM(get_hscroll_vram(line) + 0) & 0x3FF;
-    uint16_t* vsram = &VSRAM[0];
+    unsigned int ntaddr = RREG2_NAMETABLE_A;
+    uint16_t scrollx = render_hscroll[0] & 0x3FF;
+    const uint16_t* vsram = &render_vsram[0];
 
     // Check if we are in the window region only
     // if it's the case, we cancel the plane A drawing
-    int Window_line = REG18_WINDOW_VPOS * 8;
+    int Window_line = RREG18_WINDOW_VPOS * 8;
     //bool window_down = BIT(gwenesis_vdp_regs[18], 7);
-    int window_down = gwenesis_vdp_regs[18] & 0x80;
+    int window_down = RREG18_WINDOW_DOWN;
 
     int PlanA_first = PlanA_firstcol;
     int PlanA_last = PlanA_lastcol;
@@ -579,14 +455,14 @@ void draw_line_aw(int line) {
     if (window_down) {
         if (line > Window_line) {
             PlanA_first = PlanA_last = 0;
-            Window_last = screen_width;
+            Window_last = width;
             Window_first = 0;
         }
     }
     else {
         if (line < Window_line) {
             PlanA_first = PlanA_last = 0;
-            Window_last = screen_width;
+            Window_last = width;
             Window_first = 0;
         }
     }
@@ -595,53 +471,132 @@ void draw_line_aw(int line) {
     uint8_t* pos = scr + PlanA_first; // scr + screen_width;
     uint8_t* end = scr + PlanA_last; // scr + screen_width
 
-    //bool column_scrolling = BIT(gwenesis_vdp_regs[11], 2);
-    const unsigned int column_scrolling = gwenesis_vdp_regs[11] & 0x4;
-
     // Invert horizontal scrolling (because it goes right, but we need to offset
     // of the first screen pixel)
     scrollx = -scrollx;
     uint8_t col = (scrollx >> 3) & ntw_mask;
     uint8_t patx = scrollx & 7;
 
-    unsigned int numcell = 0;
     pos -= patx;
-    while (pos < end) {
-        // Calculate vertical scrolling for the current line
-        uint16_t scrolly = *vsram + line;
-        uint8_t row = (scrolly >> 3) & nth_mask;
-        uint8_t paty = scrolly & 7;
+    if (!column_scrolling) {
+        if (pos < end) {
+            const uint16_t scrolly = *vsram + line;
+            const uint8_t row = (scrolly >> 3) & nth_mask;
+            const uint8_t paty = scrolly & 7;
+            const unsigned int cells = (end - pos + 7) >> 3;
+            const uint16_t* names = get_strip(0, ntaddr + row * ntwidth_x2, col, cells);
+
+            for (unsigned int i = 0; i < cells; i++, pos += 8)
+                draw_pattern_planeA(pos, names[i], paty);
+        }
+    }
+    else {
+        unsigned int numcell = 0;
+        while (pos < end) {
+            // Calculate vertical scrolling for the current line
+            uint16_t scrolly = *vsram + line;
+            uint8_t row = (scrolly >> 3) & nth_mask;
+            uint8_t paty = scrolly & 7;
 
-        // unsigned int nt = ntaddr + row * (2 * ntwidth);
-        unsigned int nt = ntaddr + row * ntwidth_x2;
+            // unsigned int nt = ntaddr + row * (2 * ntwidth);
+            unsigned int nt = ntaddr + row * ntwidth_x2;
 
-        draw_pattern_planeA(pos, FETCH16VRAM(nt + __fast_mul(col , 2)), paty);
+            draw_pattern_planeA(pos, FETCH16VRAM(nt + __fast_mul(col , 2)), paty);
 
-        col = (col + 1) & ntw_mask;
-        pos += 8;
-        numcell++;
+            col = (col + 1) & ntw_mask;
+            pos += 8;
+            numcell++;
 
-        // If per-column scrolling is active, increment VSRAM pointer
-        if (column_scrolling && (numcell & 1) == 0)
-            vsram += 2;
+            // If per-column scrolling is active, increment VSRAM pointer
+            if (column_scrolling && (numcell & 1) == 0)
+                vsram += 2;
+        }
     }
 
-    // Second Draw Window Plane
-    int row = line >> 3;
-    int paty = line & 7;
-    //int wdwidth = (screen_width == 320 ? 64 : 32);
-    //unsigned int nt = base_w + row * 2 * wdwidth + Window_first / 4;
+    // Second Draw Window Plane, left or right of plane A
+    draw_window(scr + Window_first, line, Window_first, Window_last, width == 320 ? 128 : 64);
+}
 
-    int wdwidth_x2 = (screen_width == 320 ? 128 : 64);
+/******************************************************************************
+ *
+ *  Per line sprite lists
+ *  The sprite link chain is walked once when the SAT cache changes: each
+ *  visible line gets the sprites that cross it, in link order, up to the per
+ *  line sprite limit. The line renderers only visit those sprites.
+ *  Without GWENESIS_VDP_SPRITE_LISTS, the chain is walked on every line for
+ *  that line alone.
+ *
+ ******************************************************************************/
+#define SPRITE_LINES 240
+#define SPRITE_LINE_MAX 20 // H40 sprite limit
 
-    unsigned int nt = base_w + row * wdwidth_x2 + Window_first / 4;
+#if GWENESIS_VDP_SPRITE_LISTS
+#define SPRITE_LIST_LINES SPRITE_LINES
+#define SPRITE_LIST_SLOT(line) (line)
+#else
+#define SPRITE_LIST_LINES 1
+#define SPRITE_LIST_SLOT(line) 0
+#endif
 
-    #pragma GCC unroll(64)
-    for (int i = Window_first / 8; i < Window_last / 8; ++i) {
-        draw_pattern_planeA(end, FETCH16VRAM(nt), paty);
-        nt += 2;
-        end += 8;
+bool gwenesis_vdp_sprites_dirty = true;
+static uint8_t sprite_line_count[SPRITE_LIST_LINES];
+static uint8_t sprite_line_list[SPRITE_LIST_LINES][SPRITE_LINE_MAX];
+#if GWENESIS_VDP_SPRITE_LISTS
+static int sprite_lists_first = SPRITE_LINES; // first line the lists are valid for
+static int sprite_lists_width;
+#endif
+
+/* Lists of lines [first_line, end_line) */
+static void build_sprite_lists(int first_line, int end_line) {
+    // This is both the size of the table as seen by the VDP
+    // *and* the maximum number of sprites that are processed
+    // (important in case of infinite loops in links).
+    const int SPRITE_TABLE_SIZE = (render_width == 320) ? 80 : 64;
+    const int MAX_SPRITES_PER_LINE = (render_width == 320) ? 20 : 16;
+
+    memset(&sprite_line_count[SPRITE_LIST_SLOT(first_line)], 0, end_line - first_line);
+
+    int sidx = 0;
+    for (int i = 0; i < SPRITE_TABLE_SIZE && sidx < SPRITE_TABLE_SIZE; ++i) {
+        const uint8_t* cache = SAT_CACHE + __fast_mul(sidx, 8);
+
+        const int sy = (((cache[0] & 0x3) << 8) | cache[1]) - 128;
+        const int sh = BITS(cache[2], 0, 2) + 1;
+        const int link = BITS(cache[3], 0, 7);
+
+        const int top = sy > first_line ? sy : first_line;
+        const int bottom = sy + __fast_mul(sh, 8) < end_line ? sy + __fast_mul(sh, 8) : end_line;
+
+        for (int line = top; line < bottom; line++) {
+            const int slot = SPRITE_LIST_SLOT(line);
+            if (sprite_line_count[slot] < MAX_SPRITES_PER_LINE)
+                sprite_line_list[slot][sprite_line_count[slot]++] = sidx;
+        }
+
+        if (link == 0)
+            break;
+        sidx = link;
+    }
+}
+
+/* Rebuild the lists from this line on if the SAT cache or the table size changed */
+static inline __attribute__((always_inline))
+void update_sprite_lists(int line) {
+#if GWENESIS_VDP_SPRITE_LISTS
+    if (line < sprite_lists_first || sprite_lists_width != render_width ||
+        __atomic_load_n(&gwenesis_vdp_sprites_dirty, __ATOMIC_RELAXED)) {
+        // clear before reading SAT cache: a write from the emulation core after this point sets it again
+        __atomic_store_n(&gwenesis_vdp_sprites_dirty, false, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        build_sprite_lists(line, SPRITE_LINES);
+        sprite_lists_first = line;
+        sprite_lists_width = render_width;
     }
+#else
+    if (line < SPRITE_LINES)
+        build_sprite_lists(line, line + 1);
+#endif
 }
 
 /******************************************************************************
@@ -652,7 +607,7 @@ void draw_line_aw(int line) {
 
 //__attribute__((optimize("unroll-loops")))
 static inline __attribute__((always_inline))
-void draw_sprites_over_planes(int line) {
+void draw_sprites_over_planes(int line, const int width) {
     uint8_t* scr = &render_buffer[PIX_OVERFLOW];
 
     //    scr = screen_buffer_line;
@@ -660,19 +615,18 @@ void draw_sprites_over_planes(int line) {
     // uint8_t mask = mode_h40 ? 0x7E : 0x7F;
     // uint8_t *start_table = VRAM + ((gwenesis_vdp_regs[5] & mask) << 9);
 
-    uint8_t* start_table = VRAM + REG5_SAT_ADDRESS;
+    uint8_t* start_table = VRAM + RREG5_SAT_ADDRESS;
 
-    // This is both the size of the table as seen by the VDP
-    // *and* the maximum number of sprites that are processed
-    // (important in case of infinite loops in links).
-    const int SPRITE_TABLE_SIZE = (screen_width == 320) ? 80 : 64;
-    const int MAX_SPRITES_PER_LINE = (screen_width == 320) ? 20 : 16;
-    const int MAX_PIXELS_PER_LINE = (screen_width == 320) ? 320 : 256;
+    const int MAX_SPRITES_PER_LINE = (width == 320) ? 20 : 16;
+    const int MAX_PIXELS_PER_LINE = width;
 
     bool masking = false, one_sprite_nonzero = false; // overdraw = false;
-    int sidx = 0, num_sprites = 0, num_pixels = 0;
+    int num_sprites = 0, num_pixels = 0;
 
-    for (int i = 0; (i < SPRITE_TABLE_SIZE) && sidx < (SPRITE_TABLE_SIZE); ++i) {
+    // sprites crossing this line, in link order
+    const uint8_t* sprites = sprite_line_list[SPRITE_LIST_SLOT(line)];
+    for (int i = 0; i < sprite_line_count[SPRITE_LIST_SLOT(line)]; ++i) {
+        const int sidx = sprites[i];
         uint8_t* table = start_table + __fast_mul(sidx, 8);
         uint8_t* cache = SAT_CACHE + __fast_mul(sidx, 8);
         //uint8_t *cache = start_table + sidx*8;
@@ -684,7 +638,6 @@ void draw_sprites_over_planes(int line) {
 
 
         int sh = BITS(cache[2], 0, 2) + 1;
-        int link = BITS(cache[3], 0, 7);
 
         int isflipv = table[4] & 0x10;
         int isfliph = table[4] & 0x8;
@@ -692,7 +645,7 @@ void draw_sprites_over_planes(int line) {
         int sw = BITS(table[2], 2, 2) + 1;
 
         sy -= 128;
-        if ((line >= sy) && (line < sy + __fast_mul(sh, 8))) {
+        {
             // Sprite masking: a sprite on column 0 masks
             // any lower-priority sprite, but with the following conditions
             //   * it only works from the second visible sprite on each line
@@ -714,7 +667,7 @@ void draw_sprites_over_planes(int line) {
                 row = sh - row - 1;
 
             sx -= 128;
-            if ((sx > (__fast_mul(-sw, 8))) && (sx < screen_width) && !masking) {
+            if ((sx > (__fast_mul(-sw, 8))) && (sx < width) && !masking) {
                 name += row;
 
                 if (isfliph) {
@@ -744,9 +697,6 @@ void draw_sprites_over_planes(int line) {
             if (++num_sprites >= MAX_SPRITES_PER_LINE)
                 break;
         }
-
-        if (link == 0) break;
-        sidx = link;
     }
 
     //  if (overdraw)
@@ -754,7 +704,7 @@ void draw_sprites_over_planes(int line) {
 }
 
 static inline __attribute__((always_inline))
-void draw_sprites(int line) {
+void draw_sprites(int line, const int width) {
     uint8_t* scr = &sprite_buffer[PIX_OVERFLOW];
 
 
@@ -763,31 +713,26 @@ void draw_sprites(int line) {
     // uint8_t mask = mode_h40 ? 0x7E : 0x7F;
     // uint8_t *start_table = VRAM + ((gwenesis_vdp_regs[5] & mask) << 9);
 
-    uint8_t* start_table = VRAM + REG5_SAT_ADDRESS;
+    uint8_t* start_table = VRAM + RREG5_SAT_ADDRESS;
 
-    // This is both the size of the table as seen by the VDP
-    // *and* the maximum number of sprites that are processed
-    // (important in case of infinite loops in links).
-    const int SPRITE_TABLE_SIZE = (screen_width == 320) ? 80 : 64;
-    const int MAX_SPRITES_PER_LINE = (screen_width == 320) ? 20 : 16;
-    const int MAX_PIXELS_PER_LINE = (screen_width == 320) ? 320 : 256;
+    const int MAX_SPRITES_PER_LINE = (width == 320) ? 20 : 16;
+    const int MAX_PIXELS_PER_LINE = width;
 
     bool masking = false, one_sprite_nonzero = false; // overdraw = false;
-    int sidx = 0, num_sprites = 0, num_pixels = 0;
-
+    int num_sprites = 0, num_pixels = 0;
 
-    for (int i = 0; i < SPRITE_TABLE_SIZE && sidx < SPRITE_TABLE_SIZE; ++i) {
+    // sprites crossing this line, in link order
+    const uint8_t* sprites = sprite_line_list[SPRITE_LIST_SLOT(line)];
+    for (int i = 0; i < sprite_line_count[SPRITE_LIST_SLOT(line)]; ++i) {
+        const int sidx = sprites[i];
         uint8_t* table = start_table + __fast_mul(sidx, 8);
-        uint8_t* cache = start_table + __fast_mul(sidx, 8);
-
-        //uint8_t *cache = SAT_CACHE + sidx * 8;
+        uint8_t* cache = SAT_CACHE + __fast_mul(sidx, 8);
 
         int sy = ((cache[0] & 0x3) << 8) | cache[1];
         int sx = ((table[6] & 0x3) << 8) | table[7];
         uint16_t name = (table[4] << 8) | table[5];
 
         int sh = BITS(cache[2], 0, 2) + 1;
-        int link = BITS(cache[3], 0, 7);
 
         int isflipv = table[4] & 0x10;
         int isfliph = table[4] & 0x8;
@@ -795,7 +740,7 @@ void draw_sprites(int line) {
         int sw = BITS(table[2], 2, 2) + 1;
 
         sy -= 128;
-        if (line >= sy && line < sy + __fast_mul(sh, 8)) {
+        {
             // Sprite masking: a sprite on column 0 masks
             // any lower-priority sprite, but with the following conditions
             //   * it only works from the second visible sprite on each line
@@ -817,7 +762,7 @@ void draw_sprites(int line) {
                 row = sh - row - 1;
 
             sx -= 128;
-            if (sx > -__fast_mul(sw, 8) && sx < screen_width && !masking) {
+            if (sx > -__fast_mul(sw, 8) && sx < width && !masking) {
                 name += row;
 
                 if (isfliph) {
@@ -846,10 +791,6 @@ void draw_sprites(int line) {
             if (++num_sprites >= MAX_SPRITES_PER_LINE)
                 break;
         }
-
-        if (link == 0)
-            break;
-        sidx = link;
     }
 
     //  if (overdraw)
@@ -863,12 +804,11 @@ void draw_sprites(int line) {
  ******************************************************************************/
 //static unsigned short current_line[320];
 
-void __time_critical_func(gwenesis_vdp_render_config)() {
-    mode_h40 = REG12_MODE_H40;
-    mode_pal = REG1_PAL;
+static void __time_critical_func(render_config)() {
+    mode_h40 = RREG12_MODE_H40;
 
-    int ntwidth = BITS(gwenesis_vdp_regs[16], 0, 2);
-    int ntheight = BITS(gwenesis_vdp_regs[16], 4, 2);
+    int ntwidth = RREG16_HSCROLL_SIZE;
+    int ntheight = RREG16_VSCROLL_SIZE;
     ntwidth = __fast_mul((ntwidth + 1), 32);
     ntheight = __fast_mul((ntheight + 1), 32);
     ntw_mask = ntwidth - 1;
@@ -878,23 +818,23 @@ void __time_critical_func(gwenesis_vdp_render_config)() {
     // Window & A planes separation
 
     if (mode_h40)
-        base_w = ((REG3_NAMETABLE_W & 0x1e) << 11);
+        base_w = ((RREG3_NAMETABLE_W & 0x1e) << 11);
     else
-        base_w = ((REG3_NAMETABLE_W & 0x1f) << 11);
+        base_w = ((RREG3_NAMETABLE_W & 0x1f) << 11);
 
 
-    bool window_right = BIT(gwenesis_vdp_regs[17], 7);
+    bool window_right = RREG17_WINDOW_RIGHT;
 
     // int window_is_bugged = 0;
     PlanA_firstcol = 0;
-    PlanA_lastcol = screen_width;
+    PlanA_lastcol = render_width;
 
     Window_firstcol = 0;
     Window_lastcol = 0;
 
     if (window_right) {
-        Window_firstcol = REG17_WINDOW_HPOS * 16;
-        Window_lastcol = screen_width;
+        Window_firstcol = RREG17_WINDOW_HPOS * 16;
+        Window_lastcol = render_width;
 
         if (Window_firstcol > Window_lastcol)
             Window_firstcol = Window_lastcol;
@@ -904,17 +844,113 @@ void __time_critical_func(gwenesis_vdp_render_config)() {
     }
     else {
         Window_firstcol = 0;
-        Window_lastcol = REG17_WINDOW_HPOS * 16;
-        if (Window_lastcol > screen_width)
-            Window_lastcol = screen_width;
+        Window_lastcol = RREG17_WINDOW_HPOS * 16;
+        if (Window_lastcol > render_width)
+            Window_lastcol = render_width;
 
         PlanA_firstcol = Window_lastcol;
-        PlanA_lastcol = screen_width;
+        PlanA_lastcol = render_width;
         // if (Window_lastcol != 0)
         //      window_is_bugged = 1;
     }
 }
 
+/******************************************************************************
+ *
+ *  Line renderer variants
+ *  The plane and sprite drawing is compiled once per display width and
+ *  column scrolling setting, so the per cell loops carry no mode tests.
+ *  render_line picks the variant for width, column scrolling and
+ *  shadow/highlight per line from the registers.
+ *
+ ******************************************************************************/
+
+/* Planes per width and column scrolling, sprites per width */
+#define DRAW_PLANES_VARIANT(width, column_scrolling) \
+    static __noinline void draw_planes_##width##_cs##column_scrolling(int line) { \
+        draw_line_b(line, width, column_scrolling); \
+        draw_line_aw(line, width, column_scrolling); \
+    }
+
+#define DRAW_SPRITES_VARIANT(width) \
+    static __noinline void draw_sprites_##width(int line) { \
+        draw_sprites(line, width); \
+    } \
+    static __noinline void draw_sprites_over_planes_##width(int line) { \
+        draw_sprites_over_planes(line, width); \
+    }
+
+DRAW_PLANES_VARIANT(256, 0)
+DRAW_PLANES_VARIANT(256, 1)
+DRAW_PLANES_VARIANT(320, 0)
+DRAW_PLANES_VARIANT(320, 1)
+DRAW_SPRITES_VARIANT(256)
+DRAW_SPRITES_VARIANT(320)
+
+/* Shadow/highlight: mix planes and the sprite line buffer */
+static inline __attribute__((always_inline))
+void mix_shi(uint8_t* line_buffer, const int width) {
+    const uint8_t* pb = &render_buffer[PIX_OVERFLOW];
+    const uint8_t* ps = &sprite_buffer[PIX_OVERFLOW];
+
+    for (int x = 0; x < width; x++) {
+        const uint8_t plane = pb[x];
+        const uint8_t sprite = ps[x];
+
+        if ((plane & 0xC0) < (sprite & 0xC0)) {
+            switch (sprite & 0x3F) {
+                // Palette=3, Sprite=14 :> draw plane, force highlight
+                case 0x3E:
+                    line_buffer[x] = 0x8410 | plane >> 1;
+                    break;
+                // Palette=3, Sprite=15 :> draw plane, force shadow
+                case 0x3F:
+                    line_buffer[x] = plane >> 1;
+                    break;
+                // draw sprite, normal
+                default:
+                    line_buffer[x] = sprite;
+                    break;
+            }
+        }
+        else {
+            line_buffer[x] = plane;
+        }
+    }
+}
+
+#define RENDER_LINE_VARIANT(width, column_scrolling, shi) \
+    static void render_line_##width##_cs##column_scrolling##_shi##shi(uint8_t* line_buffer, int line) { \
+        if (shi) { \
+            /* Mode Highlight/shadow is enabled */ \
+            memset(&sprite_buffer[PIX_OVERFLOW], 0, GWENESIS_SCREEN_WIDTH); \
+            draw_planes_##width##_cs##column_scrolling(line); \
+            draw_sprites_##width(line); \
+            mix_shi(line_buffer, width); \
+        } \
+        else { \
+            /* Normal mode*/ \
+            draw_planes_##width##_cs##column_scrolling(line); \
+            draw_sprites_over_planes_##width(line); \
+            memcpy(line_buffer, &render_buffer[PIX_OVERFLOW], width); \
+        } \
+    }
+
+RENDER_LINE_VARIANT(256, 0, 0)
+RENDER_LINE_VARIANT(256, 0, 1)
+RENDER_LINE_VARIANT(256, 1, 0)
+RENDER_LINE_VARIANT(256, 1, 1)
+RENDER_LINE_VARIANT(320, 0, 0)
+RENDER_LINE_VARIANT(320, 0, 1)
+RENDER_LINE_VARIANT(320, 1, 0)
+RENDER_LINE_VARIANT(320, 1, 1)
+
+// index: H40 << 2 | column scrolling << 1 | shadow/highlight
+static void (* const render_line_variants[8])(uint8_t* line_buffer, int line) = {
+    render_line_256_cs0_shi0, render_line_256_cs0_shi1, render_line_256_cs1_shi0, render_line_256_cs1_shi1,
+    render_line_320_cs0_shi0, render_line_320_cs0_shi1, render_line_320_cs1_shi0, render_line_320_cs1_shi1,
+};
+
 /******************************************************************************
  *
  *  Render a line on screen
@@ -922,9 +958,9 @@ void __time_critical_func(gwenesis_vdp_render_config)() {
  *
  ******************************************************************************/
 
-void gwenesis_vdp_render_line(int line) {
-    uint8_t* line_buffer = &screen_buffer_line[__fast_mul(line, screen_width)];
-    mode_h40 = REG12_MODE_H40;
+static void render_line(int line) {
+    uint8_t* line_buffer = &screen_buffer_line[__fast_mul(line & screen_buffer_mask, render_width)];
+    mode_h40 = RREG12_MODE_H40;
     //mode_pal = REG1_PAL;
 
     vdpg_log(__FUNCTION__, ": %3d", line);
@@ -933,69 +969,167 @@ void gwenesis_vdp_render_line(int line) {
     // if (line == 0) gwenesis_vdp_render_config();
 
     // interlace mode not implemented
-    if (BITS(gwenesis_vdp_regs[12], 1, 2) != 0)
+    if (RREG12_INTERLACE != 0)
         return;
 
-    if (line >= (REG1_PAL ? 240 : 224))
+    if (line >= (RREG1_PAL ? 240 : 224))
         return;
 
     // Disable display >> black SCREEN
-    if (REG0_DISABLE_DISPLAY) {
-        memset(line_buffer, 0, screen_width);
+    if (RREG0_DISABLE_DISPLAY) {
+        memset(line_buffer, 0, render_width);
         return;
     }
 
     // Display is not enabled. fill with background colour
-    if (REG1_DISP_ENABLED == 0) {
-        memset(line_buffer, 0, screen_width);
+    if (RREG1_DISP_ENABLED == 0) {
+        memset(line_buffer, 0, render_width);
         return;
     }
 
 
-    const uint8_t* pb = &render_buffer[PIX_OVERFLOW];
-    uint8_t* ps = &sprite_buffer[PIX_OVERFLOW];
-
-    if (MODE_SHI)
-        memset(ps, 0, GWENESIS_SCREEN_WIDTH);
-
-    draw_line_b(line);
-    draw_line_aw(line);
-
-    /* Mode Highlight/shadow is enabled */
-    if (MODE_SHI) {
-        draw_sprites(line);
-
-        for (int x = 0; x < screen_width; x++) {
-            const uint8_t plane = pb[x];
-            const uint8_t sprite = ps[x];
-
-            if ((plane & 0xC0) < (sprite & 0xC0)) {
-                switch (sprite & 0x3F) {
-                    // Palette=3, Sprite=14 :> draw plane, force highlight
-                    case 0x3E:
-                        line_buffer[x] = 0x8410 | plane >> 1;
-                        break;
-                    // Palette=3, Sprite=15 :> draw plane, force shadow
-                    case 0x3F:
-                        line_buffer[x] = plane >> 1;
-                        break;
-                    // draw sprite, normal
-                    default:
-                        line_buffer[x] = sprite;
-                        break;
-                }
-            }
-            else {
-                line_buffer[x] = plane;
-            }
-        }
+    update_sprite_lists(line);
+
+    // H32/H40, column scrolling and shadow/highlight are resolved by picking the variant
+    const int variant = (render_width == 320) << 2 | RREG11_VSCROLL_MODE << 1 | RREG12_MODE_SHI;
+    render_line_variants[variant](line_buffer, line);
+}
+
+/******************************************************************************
+ *
+ *  Line pipeline
+ *  When enabled, gwenesis_vdp_render_line only captures the state the
+ *  renderer needs for the line and queues it; another core renders the
+ *  queued lines with gwenesis_vdp_pipeline_render. VRAM and SAT are still
+ *  read live, the queue depth bounds how late those reads can be.
+ *
+ ******************************************************************************/
+
+#define LINE_QUEUE_SIZE 8 // power of 2
+
+typedef struct {
+    uint16_t line;
+    uint8_t config;              // first line of a frame: apply render config
+    uint8_t vsram_changed;       // vsram holds a new copy of VSRAM
+    uint16_t hscroll[2];         // plane A, plane B horizontal scroll
+    uint16_t width;              // screen_width when the frame started
+    uint8_t regs[0x18];          // registers 0..23
+    uint16_t vsram[VSRAM_MAX_SIZE];
+} gwenesis_vdp_line_t;
+
+static gwenesis_vdp_line_t line_queue[LINE_QUEUE_SIZE];
+static unsigned int line_queue_head; // written by the emulation core only
+static unsigned int line_queue_tail; // written by the rendering core only
+
+static bool line_pipeline;         // active for the current frame
+static bool line_pipeline_request; // applied at the next frame start
+static bool line_config_pending;
+static int line_config_width;      // screen_width at the frame start, emulation core
+static uint16_t captured_vsram[VSRAM_MAX_SIZE]; // last VSRAM sent, emulation core
+static uint16_t pipeline_vsram[VSRAM_MAX_SIZE]; // VSRAM seen by the rendering core
+
+void gwenesis_vdp_set_pipeline(bool enabled) {
+    line_pipeline_request = enabled;
+}
+
+bool gwenesis_vdp_get_pipeline() {
+    return line_pipeline_request;
+}
+
+/* Wait until the rendering core has drawn every queued line */
+void gwenesis_vdp_pipeline_sync() {
+    while (__atomic_load_n(&line_queue_tail, __ATOMIC_ACQUIRE) != line_queue_head)
+        tight_loop_contents();
+}
+
+static void pipeline_push(int line) {
+    const unsigned int head = line_queue_head;
 
-        /* Normal mode*/
+    // back-pressure: never overwrite a line that is not rendered yet
+    while (head - __atomic_load_n(&line_queue_tail, __ATOMIC_ACQUIRE) >= LINE_QUEUE_SIZE)
+        tight_loop_contents();
+
+    gwenesis_vdp_line_t* state = &line_queue[head & (LINE_QUEUE_SIZE - 1)];
+    state->line = line;
+    state->config = line_config_pending;
+    state->width = line_config_width;
+    memcpy(state->regs, vdp_live_regs, sizeof(state->regs));
+
+    const unsigned int hscroll = get_hscroll_vram(vdp_live_regs, line);
+    state->hscroll[0] = FETCH16VRAM(hscroll);
+    state->hscroll[1] = FETCH16VRAM(hscroll + 2);
+
+    // VSRAM is only sent when it differs from what the renderer already has
+    state->vsram_changed = line_config_pending || memcmp(captured_vsram, VSRAM, sizeof(captured_vsram)) != 0;
+    if (state->vsram_changed) {
+        memcpy(captured_vsram, VSRAM, sizeof(captured_vsram));
+        memcpy(state->vsram, VSRAM, sizeof(state->vsram));
     }
-    else {
-        draw_sprites_over_planes(line);
-        memcpy(line_buffer, pb, screen_width);
+    line_config_pending = false;
+
+    __atomic_store_n(&line_queue_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Render every queued line, called from the rendering core. Returns the number of lines drawn. */
+int gwenesis_vdp_pipeline_render() {
+    int rendered = 0;
+    unsigned int tail = line_queue_tail;
+
+    while (tail != __atomic_load_n(&line_queue_head, __ATOMIC_ACQUIRE)) {
+        const gwenesis_vdp_line_t* state = &line_queue[tail & (LINE_QUEUE_SIZE - 1)];
+
+        if (state->vsram_changed)
+            memcpy(pipeline_vsram, state->vsram, sizeof(pipeline_vsram));
+        render_regs = state->regs;
+        render_vsram = pipeline_vsram;
+        render_hscroll[0] = state->hscroll[0];
+        render_hscroll[1] = state->hscroll[1];
+        render_width = state->width;
+
+        if (state->config)
+            render_config();
+        render_line(state->line);
+
+        __atomic_store_n(&line_queue_tail, ++tail, __ATOMIC_RELEASE);
+        rendered++;
     }
+    return rendered;
+}
+
+/******************************************************************************
+ *
+ *  Frame start: parse plane sizes (here, or on the rendering core with the
+ *  first queued line) and switch the line pipeline on or off.
+ *
+ ******************************************************************************/
+void gwenesis_vdp_render_config() {
+    gwenesis_vdp_pipeline_sync();
+
+    mode_pal = BIT(vdp_live_regs[1], 3);
+    line_pipeline = line_pipeline_request;
+
+    // queued lines keep the width of their own frame, the caller may already have changed it
+    if (line_pipeline) {
+        line_config_width = screen_width;
+        line_config_pending = true;
+        return;
+    }
+    render_width = screen_width;
+    render_regs = vdp_live_regs;
+    render_vsram = VSRAM;
+    render_config();
+}
+
+void gwenesis_vdp_render_line(int line) {
+    if (line_pipeline) {
+        pipeline_push(line);
+        return;
+    }
+
+    const unsigned int hscroll = get_hscroll_vram(vdp_live_regs, line);
+    render_hscroll[0] = FETCH16VRAM(hscroll);
+    render_hscroll[1] = FETCH16VRAM(hscroll + 2);
+    render_line(line);
 }
 
 void gwenesis_vdp_gfx_save_state() {
@@ -21,6 +21,7 @@ __license__ = "GPLv3"
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "../cpus/M68K/m68k.h"
 #include "gwenesis_vdp.h"
 #include "../io/gwenesis_io.h"
@@ -32,6 +33,7 @@ __license__ = "GPLv3"
 #include <gwenesis/sound/gwenesis_sn76489.h>
 
 #include "pico.h"
+#include <hardware/timer.h>
 #pragma GCC optimize("Ofast")
 
 #define VDP_MEM_DISABLE_LOGGING 1
@@ -95,6 +97,20 @@ static int hvcounter_latched = 0;
 
 int hint_pending;
 
+// CRAM entries written with a new value since the last palette commit
+uint64_t gwenesis_vdp_cram_dirty = 0;
+
+// Unchanged frame detection, see gwenesis_vdp_frame_begin
+int gwenesis_vdp_skip_unchanged = 1;
+bool gwenesis_vdp_frame_changed = true;
+unsigned int gwenesis_vdp_frames_unchanged = 0;
+
+// Register bits the picture depends on: not DMA, interrupts, counters or autoincrement
+static const unsigned char picture_bits[REG_SIZE] = {
+    [0] = 0x01, [1] = 0x4C, [2] = 0xFF, [3] = 0xFF, [4] = 0xFF, [5] = 0xFF, [7] = 0xFF,
+    [11] = 0xFF, [12] = 0xFF, [13] = 0xFF, [16] = 0xFF, [17] = 0xFF, [18] = 0xFF,
+};
+
 
 // Define VIDEO MODE
 extern int mode_pal;
@@ -119,6 +135,7 @@ extern bool sprite_collision;
  *
  ******************************************************************************/
 int m68k_irq_acked(int irq) {
+    (void) irq;
     /* VINT has higher priority (Fatal Rewind) */
     if (REG1_VBLANK_INTERRUPT && (gwenesis_vdp_status & STATUS_VIRQPENDING)) {
         /* Clear VINT pending flag */
@@ -143,8 +160,15 @@ int m68k_irq_acked(int irq) {
 
 void gwenesis_vdp_reset() {
     memset(VRAM, 0, VRAM_MAX_SIZE);
+    gwenesis_vdp_tile_cache_reset();
+#if GWENESIS_VDP_EMPTY_ROWS
+    memset(gwenesis_vdp_empty_rows, 0xFF, sizeof(gwenesis_vdp_empty_rows));
+#endif
     memset(SAT_CACHE, 0, sizeof(SAT_CACHE));
+    gwenesis_vdp_sprites_dirty = true;
+    gwenesis_vdp_frame_changed = true;
     memset(CRAM, 0, sizeof(CRAM));
+    gwenesis_vdp_cram_dirty = ~0ull;
     //    memset(CRAM222, 0, sizeof(CRAM222));
     memset(VSRAM, 0, sizeof(VSRAM));
     memset(gwenesis_vdp_regs, 0, sizeof(gwenesis_vdp_regs));
@@ -269,6 +293,8 @@ static inline __attribute__((always_inline)) void gwenesis_vdp_register_w(int re
     if ((BIT(gwenesis_vdp_regs[0x1], 2) == 0) && reg > 0xA)
         return;
 
+    if ((gwenesis_vdp_regs[reg] ^ value) & picture_bits[reg])
+        gwenesis_vdp_frame_changed = true;
     gwenesis_vdp_regs[reg] = value;
     vdpm_log(__FUNCTION__, "reg:%02d <- %02x", reg, value);
 
@@ -317,12 +343,207 @@ void push_fifo(unsigned int value) {
 
 //static inline __attribute__((always_inline))
 void __not_in_flash_func(gwenesis_vdp_vram_write)(unsigned int address, unsigned int value) {
+    if (VRAM[address] != value)
+        gwenesis_vdp_frame_changed = true;
     VRAM[address] = value;
+    gwenesis_vdp_tile_cache_invalidate(address);
+    gwenesis_vdp_strip_invalidate(address);
+
+    uint32_t pixels;
+    memcpy(&pixels, &VRAM[address & ~3], 4);
+    gwenesis_vdp_empty_rows_update(address, pixels);
 
     // Update internal SAT Cache
     // used in Castlevania Bloodlines
-    if (address >= REG5_SAT_ADDRESS && address < REG5_SAT_ADDRESS + REG5_SAT_SIZE)
-        SAT_CACHE[address - REG5_SAT_ADDRESS] = value;
+    const unsigned int sat_offset = address - REG5_SAT_ADDRESS;
+    if (sat_offset < (unsigned int) REG5_SAT_SIZE) {
+        SAT_CACHE[sat_offset] = value;
+        // per line sprite lists depend on y, size and link only
+        if ((address & 4) == 0)
+            __atomic_store_n(&gwenesis_vdp_sprites_dirty, true, __ATOMIC_RELEASE);
+    }
+}
+
+/******************************************************************************
+ *
+ *   SEGA 315-5313 CRAM Write
+ *   Write a colour to CRAM on specified address. The display palette is
+ *   only updated by gwenesis_vdp_palette_commit, once per line, for the
+ *   entries that changed (or recorded for the display, see per line
+ *   palettes).
+ *
+ ******************************************************************************/
+static inline __attribute__((always_inline))
+void gwenesis_vdp_cram_write(unsigned int address, unsigned short value) {
+    const unsigned int index = (address & 0x7f) >> 1;
+
+    if (CRAM[index] != value) {
+        CRAM[index] = value;
+        gwenesis_vdp_cram_dirty |= 1ull << index;
+    }
+}
+
+/******************************************************************************
+ *
+ *  Per line palettes
+ *  The framebuffer holds palette indices and the display looks colours up
+ *  when it scans a row out, so CRAM rewritten during the active display
+ *  (water lines, gradients, status bars) would show its last colours on
+ *  the whole picture. With gwenesis_vdp_line_palettes, each frame records
+ *  the CRAM at its first line and the entries committed on the following
+ *  lines. The display driver calls gwenesis_vdp_palette_row before it
+ *  scans out a row and gets the colours of the line it shows; a frame
+ *  without changes costs one 64 entries compare per scanout.
+ *  Records go through three slots: the emulation core fills one, publishes
+ *  it at vblank and goes on with a slot that is neither published nor on
+ *  screen, so neither side waits for the other.
+ *  Without GWENESIS_VDP_LINE_PALETTES, the CRAM goes to the display palette
+ *  as it is committed.
+ *
+ ******************************************************************************/
+
+#if GWENESIS_VDP_LINE_PALETTES
+
+#define PALETTE_DELTAS 256 // per frame, further changes show from the next frame
+
+typedef struct {
+    uint8_t line;
+    uint8_t index;
+    uint16_t color;
+} palette_delta_t;
+
+typedef struct {
+    uint16_t start[CRAM_MAX_SIZE]; // CRAM at the first line
+    uint64_t resync;               // entries to send even if the display seems to have them
+    uint16_t count;
+    palette_delta_t delta[PALETTE_DELTAS];
+} palette_record_t;
+
+int gwenesis_vdp_line_palettes = 0;
+
+static palette_record_t palette_records[3];
+static palette_record_t* palette_recording;     // frame being emulated, NULL in vblank
+static int palette_write_slot = 0;              // emulation core only
+static int palette_published_slot = -1;         // written by the emulation core
+static int palette_scanned_slot = -1;           // written by the display
+
+void gwenesis_vdp_palette_frame_begin() {
+    if (!gwenesis_vdp_line_palettes)
+        return;
+
+    palette_record_t* record = &palette_records[palette_write_slot];
+    memcpy(record->start, CRAM, sizeof(record->start));
+    // entries marked dirty outside of a frame (reset, menu) may not match the display
+    record->resync = gwenesis_vdp_cram_dirty;
+    record->count = 0;
+    gwenesis_vdp_cram_dirty = 0;
+    palette_recording = record;
+}
+
+void gwenesis_vdp_palette_frame_end() {
+    if (!palette_recording)
+        return;
+    palette_recording = NULL;
+
+    __atomic_store_n(&palette_published_slot, palette_write_slot, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    const int scanned = __atomic_load_n(&palette_scanned_slot, __ATOMIC_SEQ_CST);
+
+    do {
+        palette_write_slot = (palette_write_slot + 1) % 3;
+    }
+    while (palette_write_slot == scanned);
+}
+
+static void palette_record_line(uint64_t dirty) {
+    palette_record_t* record = palette_recording;
+
+    while (dirty) {
+        const unsigned int index = __builtin_ctzll(dirty);
+        dirty &= dirty - 1;
+        if (record->count < PALETTE_DELTAS)
+            record->delta[record->count++] = (palette_delta_t) { scan_line, index, CRAM[index] };
+    }
+}
+
+static inline __attribute__((always_inline))
+void palette_row_set(uint16_t* shown, unsigned int index, uint16_t color) {
+    shown[index] = color;
+    graphics_set_palette(index, RGB888(CRAM_R(color), CRAM_G(color), CRAM_B(color)));
+}
+
+/* Display side: row of the picture about to be scanned out, going back up starts a new scan */
+void __not_in_flash_func(gwenesis_vdp_palette_row)(int row) {
+    static const palette_record_t* record = NULL;
+    static uint16_t shown[CRAM_MAX_SIZE]; // colours the display palette holds
+    static unsigned int next;
+    static int last_row = INT_MAX;
+
+    if (row < last_row) {
+        // latest record, announced before use so that the emulation core does not refill it
+        int slot;
+        do {
+            slot = __atomic_load_n(&palette_published_slot, __ATOMIC_SEQ_CST);
+            __atomic_store_n(&palette_scanned_slot, slot, __ATOMIC_SEQ_CST);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        }
+        while (slot != __atomic_load_n(&palette_published_slot, __ATOMIC_SEQ_CST));
+
+        record = slot < 0 ? NULL : &palette_records[slot];
+        next = 0;
+        if (record) {
+            for (unsigned int i = 0; i < CRAM_MAX_SIZE; i++)
+                if (shown[i] != record->start[i] || (record->resync >> i & 1))
+                    palette_row_set(shown, i, record->start[i]);
+        }
+    }
+    last_row = row;
+
+    if (!record)
+        return;
+    while (next < record->count && record->delta[next].line <= row) {
+        palette_row_set(shown, record->delta[next].index, record->delta[next].color);
+        next++;
+    }
+}
+#endif
+
+void gwenesis_vdp_palette_flush() {
+    uint64_t dirty = gwenesis_vdp_cram_dirty;
+
+#if GWENESIS_VDP_LINE_PALETTES
+    if (gwenesis_vdp_line_palettes) {
+        // vblank changes are part of the next frame start
+        if (palette_recording) {
+            gwenesis_vdp_cram_dirty = 0;
+            palette_record_line(dirty);
+        }
+        return;
+    }
+#endif
+
+    gwenesis_vdp_cram_dirty = 0;
+    while (dirty) {
+        const unsigned int index = __builtin_ctzll(dirty);
+        const unsigned short color = CRAM[index];
+        dirty &= dirty - 1;
+        graphics_set_palette(index, RGB888(CRAM_R(color), CRAM_G(color), CRAM_B(color)));
+    }
+}
+
+/******************************************************************************
+ *
+ *   SEGA 315-5313 VSRAM Write
+ *   Write a 10 bits value to VSRAM on specified address
+ *
+ ******************************************************************************/
+static inline __attribute__((always_inline))
+void gwenesis_vdp_vsram_write(unsigned int address, unsigned int value) {
+    unsigned short* entry = &VSRAM[(address & 0x7f) >> 1];
+
+    if (*entry != value)
+        gwenesis_vdp_frame_changed = true;
+    *entry = value;
 }
 
 static inline __attribute__((always_inline))
@@ -412,10 +633,7 @@ void gwenesis_vdp_dma_fill(unsigned short value) {
             break;
         case 0x3: // undocumented and buggy, see vdpfifotesting
             do {
-                uint8_t addr = (address_reg & 0x7f) >> 1;
-                CRAM[addr] = fifo[3];
-
-                graphics_set_palette(addr, RGB888(CRAM_R(CRAM[addr]), CRAM_G(CRAM[addr]), CRAM_B(CRAM[addr])));
+                gwenesis_vdp_cram_write(address_reg, fifo[3]);
 
                 address_reg += REG15_DMA_INCREMENT;
                 src_addr_low++;
@@ -424,7 +642,7 @@ void gwenesis_vdp_dma_fill(unsigned short value) {
             break;
         case 0x5: // undocumented and buggy, see vdpfifotesting:
             do {
-                VSRAM[(address_reg & 0x7f) >> 1] = fifo[3] & 0x03FF;
+                gwenesis_vdp_vsram_write(address_reg, fifo[3] & 0x03FF);
                 address_reg += REG15_DMA_INCREMENT;
                 src_addr_low++;
             }
@@ -497,10 +715,7 @@ void gwenesis_vdp_dma_m68k() {
                 do {
                     value = FETCH16RAM(src_addr);
                     push_fifo(value);
-                    uint8_t addr = (address_reg & 0x7f) >> 1;
-                    CRAM[addr] = value;
-
-                    graphics_set_palette(addr, RGB888(CRAM_R(value), CRAM_G(value), CRAM_B(value)));
+                    gwenesis_vdp_cram_write(address_reg, value);
 
                     address_reg += REG15_DMA_INCREMENT;
                     src_addr += 2;
@@ -513,7 +728,7 @@ void gwenesis_vdp_dma_m68k() {
                 do {
                     value = FETCH16RAM(src_addr);
                     push_fifo(value);
-                    VSRAM[(address_reg & 0x7f) >> 1] = value & 0x03FF;
+                    gwenesis_vdp_vsram_write(address_reg, value & 0x03FF);
                     address_reg += REG15_DMA_INCREMENT;
                     src_addr += 2;
                 }
@@ -547,10 +762,7 @@ void gwenesis_vdp_dma_m68k() {
                 do {
                     value = FETCH16ROM(src_addr);
                     push_fifo(value);
-                    uint8_t addr = (address_reg & 0x7f) >> 1;
-                    CRAM[addr] = value;
-
-                    graphics_set_palette(addr, RGB888(CRAM_R(value), CRAM_G(value), CRAM_B(value)));
+                    gwenesis_vdp_cram_write(address_reg, value);
 
                     address_reg += REG15_DMA_INCREMENT;
                     src_addr += 2;
@@ -563,7 +775,7 @@ void gwenesis_vdp_dma_m68k() {
                 do {
                     value = FETCH16ROM(src_addr);
                     push_fifo(value);
-                    VSRAM[(address_reg & 0x7f) >> 1] = value & 0x03FF;
+                    gwenesis_vdp_vsram_write(address_reg, value & 0x03FF);
                     address_reg += REG15_DMA_INCREMENT;
                     src_addr += 2;
                 }
@@ -768,22 +980,15 @@ void gwenesis_vdp_write_data_port_16(unsigned int value) {
         case 0x3: /* CRAM write */
             //vdpm_log(__FUNCTION__,"CRAM write : addr:%x increment:%d value:%04x",
             // address_reg, REG15_DMA_INCREMENT, value);
-        {
-            uint8_t addr = (address_reg & 0x7f) >> 1;
-            CRAM[addr] = value;
-
-            graphics_set_palette(addr, RGB888(CRAM_R(value), CRAM_G(value), CRAM_B(value)));
-
+            gwenesis_vdp_cram_write(address_reg, value);
             address_reg += REG15_DMA_INCREMENT;
             address_reg &= 0xFFFF;
-
             break;
-        }
         case 0x5: /* VSRAM write */
             //vdpm_log(__FUNCTION__,"VSRAM write : addr:%x increment:%d value:%04x",
             //  address_reg, REG15_DMA_INCREMENT, value);
             // printf("write dataport 16: VSRAM@%04x:%04x\n",address_reg,value);
-            VSRAM[(address_reg & 0x7f) >> 1] = value & 0X03FF;
+            gwenesis_vdp_vsram_write(address_reg, value & 0x03FF);
             address_reg += REG15_DMA_INCREMENT;
             address_reg &= 0xFFFF;
             break;
@@ -898,6 +1103,61 @@ void gwenesis_vdp_write_memory_16(unsigned int address, unsigned int value) {
     printf("unhandled gwenesis_vdp_write(%x, %x)\n", address, value);
 }
 
+/******************************************************************************
+ *
+ *  Adaptive frameskip: a frame is not drawn only while the emulation is
+ *  behind real time, and never more than max_skip frames in a row.
+ *
+ ******************************************************************************/
+static uint64_t frameskip_deadline = 0;
+static uint8_t frames_skipped = 0;
+
+bool gwenesis_vdp_frame_due(bool is_pal, int max_skip) {
+    const int64_t frame_period = is_pal ? 20000 : 16666;
+    const uint64_t now = time_us_64();
+    int64_t late = (int64_t) (now - frameskip_deadline);
+
+    // first frame, back from the menu or hopelessly behind: restart the schedule from now
+    if (late > frame_period * 8 || late < -frame_period * 8) {
+        frameskip_deadline = now;
+        late = 0;
+    }
+    frameskip_deadline += frame_period;
+
+    if (late > 0 && frames_skipped < max_skip) {
+        frames_skipped++;
+        return false;
+    }
+    frames_skipped = 0;
+    return true;
+}
+
+/******************************************************************************
+ *
+ *  Frame start: decide whether the frame gets drawn. The framebuffer keeps
+ *  the last complete frame; when no write since that frame started changed
+ *  VRAM, VSRAM or the picture bits of a register, this frame is the same
+ *  picture and is not drawn again. CRAM is not tracked: the framebuffer
+ *  holds palette indices, colours are applied at scanout.
+ *  draw: the frame would be drawn (frameskip), complete: it draws every
+ *  line, not only the even ones of an interlace frame.
+ *
+ ******************************************************************************/
+bool gwenesis_vdp_frame_begin(bool draw, bool complete) {
+    if (!draw)
+        return false;
+
+    if (gwenesis_vdp_skip_unchanged && !gwenesis_vdp_frame_changed) {
+        gwenesis_vdp_frames_unchanged++;
+        return false;
+    }
+
+    // writes from now on show up in this frame or the next one
+    if (complete)
+        gwenesis_vdp_frame_changed = false;
+    return true;
+}
+
 void gwenesis_vdp_mem_save_state() {
 }
 
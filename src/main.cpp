@@ -23,6 +23,8 @@ extern "C" {
 #include "gwenesis/savestate/gwenesis_savestate.h"
 #include <gwenesis/sound/gwenesis_sn76489.h>
 #include <gwenesis/sound/ym2612.h>
+#include <gwenesis/perf/gwenesis_perf.h>
+#include <gwenesis/perf/gwenesis_profile.h>
 }
 
 #include "graphics.h"
@@ -53,7 +55,27 @@ int snd_output_volume = 9;
 ///int ym2612_index;                                                     /* ym2612 audio buffer index */
 ///int ym2612_clock;
 semaphore vga_start_semaphore;
+#if LINE_RING
+// Race the beam: only LINE_RING scanlines are kept, line y is drawn in row y % LINE_RING
+// just ahead of the scanout. The ring also holds the text mode buffer.
+static_assert(LINE_RING >= 16 && (LINE_RING & (LINE_RING - 1)) == 0, "LINE_RING: power of 2, at least 16");
+static_assert(LINE_RING * 320 >= TEXTMODE_COLS * TEXTMODE_ROWS * 2, "LINE_RING too small for the text buffer");
+static uint8_t SCREEN[LINE_RING][320];
+#define SCREEN_ROW(y) ((y) & (LINE_RING - 1))
+#else
 static uint8_t SCREEN[240][320];
+#define SCREEN_ROW(y) (y)
+#endif
+#if DOUBLE_BUFFER
+// VDP renders into the back page while the front page is scanned out, pages swap at vblank
+static uint8_t SCREEN_BACK[240][320];
+static uint8_t* front_buffer = (uint8_t *) SCREEN;
+static uint8_t* back_buffer = (uint8_t *) SCREEN_BACK;
+#else
+// single buffer: the VDP renders straight into the scanned out page
+static uint8_t* front_buffer = (uint8_t *) SCREEN;
+static uint8_t* back_buffer = (uint8_t *) SCREEN;
+#endif
 
 enum input_device {
     KEYBOARD,
@@ -62,10 +84,14 @@ enum input_device {
 };
 
 // SETTINGS
-bool show_fps = true;
+bool show_fps = false;
 bool limit_fps = true;
 bool interlace = true;
-bool frameskip = true;
+bool render_on_core1 = false; // core 1 drains the line queue between blocking audio writes, not measured yet
+#if GWENESIS_PROFILE
+bool profile_68k = false;
+#endif
+uint8_t frameskip = 2; // maximum consecutive frames not drawn, 0 disables
 bool flash_line = false;
 bool flash_frame = false;
 int z80_enable_mode = 2;
@@ -172,7 +198,7 @@ unsigned int frame_counter = 0;
 unsigned int drawFrame = 1;
 
 extern unsigned char gwenesis_vdp_regs[0x20];
-extern unsigned int gwenesis_vdp_status;
+extern unsigned short gwenesis_vdp_status;
 extern unsigned int screen_width, screen_height;
 extern int hint_pending;
 
@@ -231,14 +257,55 @@ bool save() {
     return true;
 }
 
+#if GWENESIS_PROFILE
+static bool profile_write_line(void* context, const char* line) {
+    const UINT length = strlen(line);
+    UINT written;
+    return FR_OK == f_write((FIL *) context, line, length, &written) && written == length;
+}
+
+/* 68K PC samples so far to \SEGA\profile\<rom>.txt */
+bool dump_profile() {
+    const char* rom_name = strrchr(filename, '\\');
+    rom_name = rom_name ? rom_name + 1 : filename;
+
+    char name[80], pathname[128];
+    snprintf(name, sizeof name, "%s", rom_name);
+    char* extension = strrchr(name, '.');
+    if (extension)
+        *extension = '\0';
+    snprintf(pathname, sizeof pathname, HOME_DIR "\\profile\\%s.txt", name);
+
+    FIL file;
+    f_mkdir(HOME_DIR "\\profile");
+    bool written = FR_OK == f_open(&file, pathname, FA_WRITE | FA_CREATE_ALWAYS);
+    if (written) {
+        written = gwenesis_profile_write(rom_name, profile_write_line, &file);
+        written &= FR_OK == f_close(&file);
+    }
+    draw_text(written ? "Profile written    " : "Profile NOT written", TEXTMODE_COLS / 2 - 10, TEXTMODE_ROWS - 3,
+              written ? 10 : 13, 0);
+    return false;
+}
+#endif
+
 
 const MenuItem menu_items[] = {
     {"Player 1: %s",        ARRAY, &player_1_input, nullptr, 0, 2, {"Keyboard ", "Gamepad 1", "Gamepad 2"}},
     {"Player 2: %s",        ARRAY, &player_2_input, nullptr, 0, 2, {"Keyboard ", "Gamepad 1", "Gamepad 2"}},
-    {"Frameskip: %s", ARRAY, &frameskip, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Frameskip: %s", ARRAY, &frameskip, nullptr, 0, 4, {"NO     ", "max 1", "max 2", "max 3", "max 4"}},
     {"Interlace mode: %s", ARRAY, &interlace, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Show FPS: %s", ARRAY, &show_fps, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Render on core 1: %s", ARRAY, &render_on_core1, nullptr, 0, 1, {"NO ", "YES"}},
     {"Sound: %s", ARRAY, &audio_enabled, nullptr, 0, 1, {"Disabled", "Enabled "}},
     {"Z80 emulation: %s", ARRAY, &z80_enable_mode, nullptr, 0, 2, {"Disabled ", "Partial  ", "Full-lags"}},
+    {"68K idle skip: %s", ARRAY, &m68k_idle_skip, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Z80 idle skip: %s", ARRAY, &z80_idle_skip, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Skip same frames: %s", ARRAY, &gwenesis_vdp_skip_unchanged, nullptr, 0, 1, {"NO ", "YES"}},
+#if GWENESIS_PROFILE
+    {"68K profiler: %s", ARRAY, &profile_68k, nullptr, 0, 1, {"NO ", "YES"}},
+    {"Dump 68K profile to SD", SAVE, nullptr, &dump_profile},
+#endif
     {"SN76489 chip: %s",  ARRAY, &sn76489_enabled, nullptr, 0, 1, {"Disabled", "Enabled "}},
     {"Sampling div: %s ", ARRAY, &GWENESIS_AUDIO_SAMPLING_DIVISOR, nullptr, 0, 10, {"!", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10"}},
     {
@@ -260,6 +327,9 @@ const MenuItem menu_items[] = {
 
 void menu() {
     bool exit = false;
+#if GWENESIS_PROFILE
+    gwenesis_profile_running = false; // the menu is not part of the game
+#endif
     graphics_set_mode(TEXTMODE_DEFAULT);
     char footer[TEXTMODE_COLS];
     snprintf(footer, TEXTMODE_COLS, ":: %s ::", PICO_PROGRAM_NAME);
@@ -348,6 +418,9 @@ void menu() {
         sleep_ms(125);
     }
 
+#if GWENESIS_PROFILE
+    gwenesis_profile_running = profile_68k;
+#endif
     graphics_set_mode(GRAPHICSMODE_DEFAULT);
 }
 
@@ -359,7 +432,14 @@ typedef struct __attribute__((__packed__)) {
 } file_item_t;
 
 constexpr int max_files = 600;
+#if LINE_RING
+// no room left in the line ring, VRAM is unused until the game is started
+extern "C" unsigned char VRAM[];
+static_assert(max_files * sizeof(file_item_t) <= VRAM_MAX_SIZE, "file list does not fit in VRAM");
+file_item_t* fileItems = (file_item_t *) VRAM;
+#else
 file_item_t* fileItems = (file_item_t *) (&SCREEN[0][0] + TEXTMODE_COLS * TEXTMODE_ROWS * 2);
+#endif
 
 int compareFileItems(const void* a, const void* b) {
     const auto* itemA = (file_item_t *) a;
@@ -414,6 +494,7 @@ bool filebrowser_loadfile(const char pathname[256]) {
 
 
     draw_text("Loading...", window_x + 1, window_y + 2, 10, 1);
+    snprintf(filename, sizeof filename, "%s", pathname);
     sleep_ms(500);
 
 
@@ -694,10 +775,21 @@ void gwenesis_io_get_buttons() {
         button_state[1] = ~button_state[1];
 
     if ((gamepad1.bits.start && gamepad1.bits.c) || keyboard.bits.mode) {
+        // core 1 may still be drawing queued lines into SCREEN
+        gwenesis_vdp_pipeline_sync();
         menu();
+        gwenesis_vdp_frame_changed = true; // settings or the overlay may have changed
+        gwenesis_vdp_cram_dirty = ~0ull;   // the text mode may have used the palette
     }
 }
 
+#if GWENESIS_PROFILE
+static bool __not_in_flash_func(profile_timer_callback)(repeating_timer_t* timer) {
+    gwenesis_profile_sample();
+    return true;
+}
+#endif
+
 /* Renderer loop on Pico's second core */
 void __scratch_x("render") render_core() {
     multicore_lockout_victim_init();
@@ -716,12 +808,26 @@ void __scratch_x("render") render_core() {
     const auto buffer = (uint8_t *) SCREEN;
     graphics_set_buffer(buffer, GWENESIS_SCREEN_WIDTH, GWENESIS_SCREEN_HEIGHT);
     graphics_set_textbuffer(buffer);
+#if LINE_RING
+    graphics_set_ring(LINE_RING);
+#elif GWENESIS_VDP_LINE_PALETTES
+    // the scanout applies the CRAM of each line; the ring renders too close to the beam to keep records
+    gwenesis_vdp_line_palettes = 1;
+    graphics_set_row_callback(gwenesis_vdp_palette_row);
+#endif
     graphics_set_bgcolor(0x000000);
     graphics_set_offset(0, 0);
 
     graphics_set_flashmode(false, false);
     sem_acquire_blocking(&vga_start_semaphore);
 
+#if GWENESIS_PROFILE
+    // samples core 0 from an alarm pool of this core, so its interrupt is taken here
+    static repeating_timer_t profile_timer;
+    alarm_pool_add_repeating_timer_us(alarm_pool_create(1, 4), -1000000 / GWENESIS_PROFILE_HZ, profile_timer_callback,
+                                      nullptr, &profile_timer);
+#endif
+
     // 60 FPS loop
 #define frame_tick (16666)
     uint64_t tick = time_us_64();
@@ -743,8 +849,12 @@ void __scratch_x("render") render_core() {
 
         tick = time_us_64();
 
+        // VDP lines queued by core 0 when rendering on core 1 is enabled
+        gwenesis_vdp_pipeline_render();
+
         if (audio_enabled && old_frame != frame ) {
 #if TFT | VGA
+            // on core 1: the rest of the frame's samples are out of the core 0 budget
             gwenesis_SN76489_run(lines_per_frame * VDP_CYCLES_PER_LINE);
 #endif
             static int16_t snd_buf[GWENESIS_AUDIO_BUFFER_LENGTH_NTSC * 2];
@@ -762,8 +872,189 @@ void __scratch_x("render") render_core() {
 }
 
 
+extern unsigned short CRAM[];
+
+/* Brightest and darkest CRAM entries, so the overlay stays readable whatever the game palette is */
+static void overlay_colors(uint8_t &fg, uint8_t &bg) {
+    int max_luma = -1, min_luma = INT32_MAX;
+    for (int i = 0; i < 64; i++) {
+        const int luma = CRAM_R(CRAM[i]) * 2 + CRAM_G(CRAM[i]) * 5 + CRAM_B(CRAM[i]);
+        if (luma > max_luma) {
+            max_luma = luma;
+            fg = i;
+        }
+        if (luma < min_luma) {
+            min_luma = luma;
+            bg = i;
+        }
+    }
+}
+
+#define OVERLAY_LINES ((PERF_SLOTS + 2) / 3) // text lines of 8 rows, 3 perf slots per line
+
+static char overlay_text[OVERLAY_LINES][TEXTMODE_COLS + 1];
+static int overlay_rows; // pixel rows of the text
+static uint8_t overlay_fg, overlay_bg;
+
+/* Pixel row y of the overlay, drawn over the same row of the picture */
+static void draw_overlay_row(const int y) {
+    // a frame that is not drawn is not flipped either: refresh the overlay of the page on screen
+    uint8_t* pixel = (drawFrame ? back_buffer : front_buffer) + SCREEN_ROW(y) * screen_width;
+    const char* text = overlay_text[y / 8];
+    for (int x = 0; *text && x + 6 <= screen_width; text++, x += 6) {
+        const uint8_t glyph_row = font_6x8[(uint8_t) *text * 8 + y % 8];
+        for (int bit = 0; bit < 6; bit++) {
+            *pixel++ = glyph_row >> bit & 1 ? overlay_fg : overlay_bg;
+        }
+    }
+}
+
+/* FPS, share of 68K and Z80 time skipped in idle loops and, with GWENESIS_PERF, the average ms per frame spent in each
+ * subsystem over the last second. Once per frame, the text is drawn by draw_overlay_row */
+static void update_fps_overlay() {
+    static uint64_t fps_timer = 0;
+    static int fps_frames = 0, fps = 0;
+    static unsigned int idle_cycles = 0, idle_percent = 0;
+    static unsigned int z80_idle_last = 0, z80_idle_percent = 0;
+    static unsigned int unchanged_last = 0, unchanged_percent = 0;
+#if GWENESIS_PERF
+    static const char* const perf_labels[PERF_SLOTS] = { "---", "68K", "Z80", "VDP", "SND", "WAIT" };
+    static uint32_t perf_sum[PERF_SLOTS] = {}, perf_avg[PERF_SLOTS] = {};
+
+    for (int i = 0; i < PERF_SLOTS; i++)
+        perf_sum[i] += gwenesis_perf_frame[i];
+#endif
+    fps_frames++;
+
+    const uint64_t now = time_us_64();
+    if (now - fps_timer >= 1000000) {
+        fps = fps_frames;
+        idle_percent = (uint64_t) (m68k_idle_cycles - idle_cycles) * 100 /
+                       ((uint64_t) fps_frames * lines_per_frame * VDP_CYCLES_PER_LINE);
+        idle_cycles = m68k_idle_cycles;
+        z80_idle_percent = (uint64_t) (z80_idle_cycles - z80_idle_last) * 100 /
+                           ((uint64_t) fps_frames * lines_per_frame * VDP_CYCLES_PER_LINE);
+        z80_idle_last = z80_idle_cycles;
+        unchanged_percent = (gwenesis_vdp_frames_unchanged - unchanged_last) * 100 / fps_frames;
+        unchanged_last = gwenesis_vdp_frames_unchanged;
+#if GWENESIS_PERF
+        for (int i = 0; i < PERF_SLOTS; i++) {
+            perf_avg[i] = perf_sum[i] / fps_frames;
+            perf_sum[i] = 0;
+        }
+#endif
+        fps_frames = 0;
+        fps_timer = now;
+    }
+
+    overlay_colors(overlay_fg, overlay_bg);
+
+    char* text = overlay_text[0];
+    int length = snprintf(text, sizeof overlay_text[0], "FPS %d", fps);
+    if (m68k_idle_skip)
+        length += snprintf(text + length, sizeof overlay_text[0] - length, " IDLE %u%%", idle_percent);
+    if (z80_idle_skip && z80_enable_mode)
+        length += snprintf(text + length, sizeof overlay_text[0] - length, " Z80 IDLE %u%%", z80_idle_percent);
+    if (gwenesis_vdp_skip_unchanged)
+        length += snprintf(text + length, sizeof overlay_text[0] - length, " SAME %u%%", unchanged_percent);
+#if GWENESIS_PERF
+    int line = 0;
+    for (int i = 1; i <= PERF_SLOTS; i++) {
+        const int slot = i % PERF_SLOTS; // unattributed time last
+        length += snprintf(text + length, sizeof overlay_text[0] - length, " %s %u.%u", perf_labels[slot],
+                           (unsigned) perf_avg[slot] / 1000, (unsigned) perf_avg[slot] / 100 % 10);
+        if (i % 3 == 0 && i < PERF_SLOTS) {
+            text = overlay_text[++line];
+            length = 0;
+        }
+    }
+    overlay_rows = (line + 1) * 8;
+#else
+    overlay_rows = 8;
+#endif
+}
+
+#if !LINE_RING
+static void draw_fps_overlay() {
+    update_fps_overlay();
+    for (int y = 0; y < overlay_rows; y++)
+        draw_overlay_row(y);
+}
+#endif
+
+/* Interlace mode draws only the even lines of odd frames: take the odd ones
+ * from the page on screen, or the pages would alternate with stale lines */
+static inline void keep_skipped_lines() {
+#if DOUBLE_BUFFER
+    for (unsigned int y = 1; y < screen_height; y += 2)
+        memcpy(back_buffer + y * screen_width, front_buffer + y * screen_width, screen_width);
+#endif
+}
+
+#if DOUBLE_BUFFER
+static bool flip_pending = false;
+static uint32_t flip_frame; // scanout frame number when the page was handed to the driver
+#endif
+
+/* Show the page just rendered and hand the other one to the VDP */
+static inline void flip_buffers() {
+#if DOUBLE_BUFFER
+    gwenesis_vdp_pipeline_sync(); // core 1 has to be done with the back page
+    uint8_t* const rendered = back_buffer;
+    back_buffer = front_buffer;
+    front_buffer = rendered;
+    graphics_set_buffer(front_buffer, screen_width, screen_height);
+    gwenesis_vdp_set_buffer(back_buffer);
+    // read after the handover: a frame that started before it may still show the old page
+    flip_frame = graphics_get_beam() >> 10;
+    flip_pending = true;
+#endif
+}
+
+/* The page given back by flip_buffers is scanned out until the driver latches
+ * the new one at its next vblank: wait for that before drawing into it */
+static inline void wait_flip() {
+#if DOUBLE_BUFFER
+    if (!flip_pending)
+        return;
+    while (graphics_get_beam() >> 10 == flip_frame)
+        tight_loop_contents();
+    flip_pending = false;
+#endif
+}
+
+#if LINE_RING
+static uint32_t ring_frame; // scanout frame the emulated frame is shown in
+
+/* Back-pressure: line y may only replace a ring row the beam has already read */
+static inline void ring_wait(const int y) {
+    while (true) {
+        const uint32_t beam = graphics_get_beam();
+        const int frames = (int32_t) ((ring_frame - (beam >> 10)) << 10) >> 10; // frame numbers are 22 bits
+        const int distance = frames * screen_height + y - (int) (beam & 0x3FF);
+        if (distance < 0) {
+            // the beam already passed this line, aim at the next frame
+            ring_frame = (beam >> 10) + 1;
+            continue;
+        }
+        if (distance < LINE_RING)
+            return;
+        tight_loop_contents();
+    }
+}
+#endif
+
 void __time_critical_func(emulate)() {
-    gwenesis_vdp_set_buffer((uint8_t *) SCREEN);
+    gwenesis_vdp_set_buffer(back_buffer);
+#if LINE_RING
+    gwenesis_vdp_set_buffer_lines(LINE_RING);
+    ring_frame = graphics_get_beam() >> 10;
+#endif
+    PERF_RESET();
+#if GWENESIS_PROFILE
+    gwenesis_profile_reset();
+    gwenesis_profile_running = profile_68k;
+#endif
     while (!reboot) {
         /* Eumulator loop */
         int hint_counter = gwenesis_vdp_regs[10];
@@ -775,29 +1066,70 @@ void __time_critical_func(emulate)() {
 
         // graphics_set_buffer(buffer, screen_width, screen_height);
         // TODO: move to separate function graphics_set_dimensions ?
-        graphics_set_buffer((uint8_t*)SCREEN, screen_width, screen_height);
+        graphics_set_buffer(front_buffer, screen_width, screen_height);
         graphics_set_offset(screen_width != 320 ? 32 : 0, screen_height != 240 ? 8 : 0);
+        gwenesis_vdp_set_pipeline(render_on_core1);
         gwenesis_vdp_render_config();
 
+#if LINE_RING
+        ring_frame++;
+        drawFrame = true; // the ring keeps no frame to repeat
+        if (show_fps)
+            update_fps_overlay();
+#else
+        // odd lines of an interlace frame are only drawn on even frames
+        drawFrame = gwenesis_vdp_frame_begin(gwenesis_vdp_frame_due(is_pal, frameskip), !interlace || frame % 2 == 0);
+        if (drawFrame) {
+            PERF_SWITCH(PERF_LIMITER);
+            wait_flip();
+            PERF_SWITCH(PERF_OTHER);
+        }
+#endif
+
         zclk = 0;
         /* Reset the difference clocks and audio index */
         system_clock = 0;
         sn76489_clock = 0;
         sn76489_index = 0;
         scan_line = 0;
-         if (z80_enable_mode == 1)
+        gwenesis_vdp_palette_frame_begin();
+         if (z80_enable_mode == 1) {
+            PERF_SWITCH(PERF_Z80);
             z80_run(lines_per_frame * VDP_CYCLES_PER_LINE);
+            PERF_SWITCH(PERF_OTHER);
+        }
 
         while (scan_line < lines_per_frame) {
             /* CPUs */
+            PERF_SWITCH(PERF_M68K);
             m68k_run(system_clock + VDP_CYCLES_PER_LINE);
-            if (z80_enable_mode == 2)
-                    z80_run(system_clock + VDP_CYCLES_PER_LINE);
+            if (z80_enable_mode == 2) {
+                PERF_SWITCH(PERF_Z80);
+                z80_run(system_clock + VDP_CYCLES_PER_LINE);
+            }
+            // CRAM entries the CPUs changed during the line
+            gwenesis_vdp_palette_commit();
             /* Video */
+#if LINE_RING
+            if (scan_line < screen_height) {
+                PERF_SWITCH(PERF_LIMITER);
+                ring_wait(scan_line);
+                PERF_SWITCH(PERF_VDP);
+                gwenesis_vdp_render_line(scan_line); /* render scan_line */
+                // each overlay row goes over its line as soon as the line is in the ring, ahead of the beam
+                if (show_fps && scan_line < overlay_rows) {
+                    gwenesis_vdp_pipeline_sync();
+                    draw_overlay_row(scan_line);
+                }
+            }
+#else
             // Interlace mode
-            if (drawFrame && !interlace || (frame % 2 == 0 && scan_line % 2) || scan_line % 2 == 0) {
+            if (drawFrame && (!interlace || (frame % 2 == 0 && scan_line % 2) || scan_line % 2 == 0)) {
+                PERF_SWITCH(PERF_VDP);
                 gwenesis_vdp_render_line(scan_line); /* render scan_line */
             }
+#endif
+            PERF_SWITCH(PERF_OTHER);
 
             // On these lines, the line counter interrupt is reloaded
             if (scan_line == 0 || scan_line > screen_height) {
@@ -818,6 +1150,19 @@ void __time_critical_func(emulate)() {
 
             // vblank begin at the end of last rendered line
             if (scan_line == screen_height) {
+#if !LINE_RING
+                // core 1 may still be rendering into the page the next writes go to
+                gwenesis_vdp_pipeline_sync();
+                // before the overlay, which is drawn on top of every line
+                if (drawFrame && interlace && frame % 2)
+                    keep_skipped_lines();
+                if (show_fps)
+                    draw_fps_overlay();
+#endif
+                if (drawFrame)
+                    flip_buffers();
+                gwenesis_vdp_palette_frame_end();
+
                 if (REG1_VBLANK_INTERRUPT != 0) {
                     gwenesis_vdp_status |= STATUS_VIRQPENDING;
                     m68k_set_irq(6);
@@ -827,32 +1172,33 @@ void __time_critical_func(emulate)() {
 
             if (!is_pal && scan_line == screen_height + 1) {
                 z80_irq_line(0);
-                // FRAMESKIP every 3rd frame
-                drawFrame = frameskip && frame % 3 != 0;
-                // if (frameskip && frame % 3 == 0) {
-                //     drawFrame = 0;
-                // } else {
-                //     drawFrame = 1;
-                // }
             }
 
             system_clock += VDP_CYCLES_PER_LINE;
         }
 
         frame++;
+#if !LINE_RING
+        // the ring is paced by the beam already
         if (limit_fps) {
             frame_cnt++;
             if (frame_cnt == (is_pal ? 5 : 6)) {
+                PERF_SWITCH(PERF_LIMITER);
                 while (time_us_64() - frame_timer_start < (is_pal ? 20000 * 5 : 16666 * 6)) {
                     busy_wait_at_least_cycles(10);
                 }; // 60 Hz
                 frame_timer_start = time_us_64();
                 frame_cnt = 0;
+                PERF_SWITCH(PERF_OTHER);
             }
         }
+#endif
 #if HDMI | SOFTTV | TV
-        if (audio_enabled)
+        if (audio_enabled) {
+            PERF_SWITCH(PERF_SOUND);
             gwenesis_SN76489_run(REG1_PAL ? LINES_PER_FRAME_PAL : LINES_PER_FRAME_NTSC * VDP_CYCLES_PER_LINE);
+            PERF_SWITCH(PERF_OTHER);
+        }
 #endif
         // ym2612_run(262 * VDP_CYCLES_PER_LINE);
         /*
@@ -866,10 +1212,16 @@ void __time_critical_func(emulate)() {
         // reset m68k cycles to the begin of next frame cycle
         m68k.cycles -= system_clock;
 
+        PERF_END_FRAME();
+
         /* copy audio samples for DMA */
         //gwenesis_sound_submit();
 
     }
+    gwenesis_vdp_pipeline_sync();
+#if GWENESIS_PROFILE
+    gwenesis_profile_running = false;
+#endif
     reboot = false;
 }
 